@@ -0,0 +1,57 @@
+// Hash micro-benchmark - compares hash engines used for names of extracted attachments.
+//
+// build: cmake --build . --target hashbench
+// usage: hashbench [seconds per case]
+
+#include "../src/md5.h"
+#include "../src/xxh3.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+typedef string (*HashFunction)(const char *data, size_t length);
+
+static string md5copy(const char *data, size_t length) {
+    return md5(string(data, length)); // the original CountMD5 path
+}
+
+static double Measure(HashFunction hash, const vector<char> &data, double seconds, string &digest) {
+    typedef std::chrono::steady_clock clock;
+    size_t bytes = 0;
+    clock::time_point start = clock::now();
+    double elapsed = 0;
+    do {
+        digest = hash(data.data(), data.size());
+        bytes += data.size();
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < seconds);
+    return bytes / elapsed / (1024 * 1024);
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 0.5;
+    size_t sizes[] = { 1024, 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+    struct { const char *name; HashFunction hash; } engines[] = {
+        { "xxh3", xxh3 },
+        { "md5", md5 },
+        { "md5+copy", md5copy }
+    };
+
+    printf("%-10s %10s %12s  %s\n", "engine", "size", "MB/s", "digest");
+    for (size_t size : sizes) {
+        vector<char> data(size);
+        for (size_t i = 0; i < size; i++) data[i] = (char) (rand() & 0xff);
+        for (auto &engine : engines) {
+            string digest;
+            double speed = Measure(engine.hash, data, seconds, digest);
+            printf("%-10s %10zu %12.1f  %s\n", engine.name, size, speed, digest.c_str());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,491 @@
+// Read/write throughput benchmark - synthesizes MP3, FLAC and Ogg Vorbis corpora
+// and measures the work the MPEG, FLAC and Ogg workers do on the pool thread.
+//
+// Workers themselves are V8 objects, the benchmark links the rest of tagio and
+// calls the same functions without Node: read runs the format reader and builds
+// the Result (metadata cache disabled), cached reads again with the metadata
+// cache, extract also stores attached pictures as fileExtracted AS_FILENAME does,
+// write replaces the tag (title alternating) the way writeMPEG, writeFLAC and
+// writeOgg save it. Materialization to V8 values is not measured.
+//
+// build: cmake --build . --target iobench
+// usage: iobench [--files=N] [--frames=N] [--text=BYTES] [--artwork=BYTES]
+//                [--audio=BYTES] [--rounds=N] [--dir=PATH] [--keep]
+
+#include "../src/configuration.h"
+#include "../src/reader.h"
+#include "../src/result.h"
+#include "../src/mpeg.h"
+#include "../src/flac.h"
+#include "../src/ogg.h"
+
+#include <taglib/tbytevector.h>
+#include <taglib/tstring.h>
+#include <taglib/mpegfile.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/id3v2frame.h>
+#include <taglib/attachedpictureframe.h>
+#include <taglib/textidentificationframe.h>
+#include <taglib/flacfile.h>
+#include <taglib/flacpicture.h>
+#include <taglib/vorbisfile.h>
+#include <taglib/xiphcomment.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using std::map;
+
+struct Options {
+    size_t files = 100;             // per format
+    size_t frames = 16;             // text frames (fields) per tag
+    size_t text = 32;               // bytes per text frame
+    size_t artwork = 64 * 1024;     // picture size, 0 - no picture
+    size_t audio = 256 * 1024;      // audio data size
+    size_t rounds = 3;              // passes over the corpus per operation
+    string dir;
+    bool keep = false;
+};
+
+enum Format { FORMAT_MPEG, FORMAT_FLAC, FORMAT_OGG };
+static const char *FORMAT_NAMES[] = { "mpeg", "flac", "ogg" };
+static const char *FORMAT_EXTENSIONS[] = { ".mp3", ".flac", ".ogg" };
+
+
+// -- corpus --------------------------------------------------------------
+
+static void PutUint32BE(string &s, uint32_t v) {
+    for (int i = 3; i >= 0; i--) s += (char) ((v >> (i * 8)) & 0xff);
+}
+
+static void PutUint32LE(string &s, uint32_t v) {
+    for (int i = 0; i < 4; i++) s += (char) ((v >> (i * 8)) & 0xff);
+}
+
+static bool WriteFile(const string &path, const string &data) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static string Random(size_t size) {
+    string s(size, '\0');
+    for (size_t i = 0; i < size; i++) s[i] = (char) (rand() & 0xff);
+    return s;
+}
+
+static string Text(size_t size) {
+    string s(size, ' ');
+    for (size_t i = 0; i < size; i++) s[i] = (char) ('a' + rand() % 26);
+    return s;
+}
+
+// JPEG signature and random content - unique per file, so every extraction stores a file.
+static TagLib::ByteVector Artwork(size_t size) {
+    string s = "\xFF\xD8\xFF\xE0" + Random(size > 4 ? size - 4 : 0);
+    return TagLib::ByteVector(s.data(), (unsigned int) s.size());
+}
+
+// MPEG-1 Layer III, 128 kbps, 44.1 kHz - 417 bytes long frames of silence.
+static string MPEGAudio(size_t size) {
+    string frame("\xFF\xFB\x90\x00", 4);
+    frame.append(417 - 4, '\0');
+    string s;
+    for (size_t i = 0; i * 417 < size; i++) s += frame;
+    return s;
+}
+
+// fLaC marker, the last STREAMINFO block and frame data (not decoded by TagLib).
+static string FLACAudio(size_t size) {
+    const uint64_t samples = 44100 * 10;
+    string s("fLaC\x80\x00\x00\x22", 8);
+    s += string("\x10\x00\x10\x00", 4);     // min/max block size 4096
+    s += string(6, '\0');                   // min/max frame size unknown
+    uint64_t info = ((uint64_t) 44100 << 44) | ((uint64_t) 1 << 41) | ((uint64_t) 15 << 36) | samples;
+    PutUint32BE(s, (uint32_t) (info >> 32));
+    PutUint32BE(s, (uint32_t) info);
+    s += string(16, '\0');                  // MD5 of audio
+    s += string("\xFF\xF8", 2);
+    s += Random(size);
+    return s;
+}
+
+static uint32_t OggCRC(const string &page) {
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t r = i << 24;
+            for (int j = 0; j < 8; j++) r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : r << 1;
+            table[i] = r;
+        }
+    }
+    uint32_t crc = 0;
+    for (unsigned char c : page) crc = (crc << 8) ^ table[((crc >> 24) & 0xff) ^ c];
+    return crc;
+}
+
+static string OggPage(const vector<string> &packets, unsigned char type, uint64_t granule, uint32_t sequence) {
+    string lacing;
+    string data;
+    for (const string &packet : packets) {
+        for (size_t n = packet.size(); ; n -= 255) {
+            lacing += (char) (n >= 255 ? 255 : n);
+            if (n < 255) break;
+        }
+        data += packet;
+    }
+    string page("OggS\0", 5);
+    page += (char) type;
+    PutUint32LE(page, (uint32_t) granule);
+    PutUint32LE(page, (uint32_t) (granule >> 32));
+    PutUint32LE(page, 0x7A67696F);          // stream serial number
+    PutUint32LE(page, sequence);
+    PutUint32LE(page, 0);                   // CRC
+    page += (char) lacing.size();
+    page += lacing + data;
+    uint32_t crc = OggCRC(page);
+    for (int i = 0; i < 4; i++) page[22 + i] = (char) ((crc >> (i * 8)) & 0xff);
+    return page;
+}
+
+// Vorbis identification, empty comment and dummy setup header, audio in 4000 bytes long packets.
+static string OggAudio(size_t size) {
+    string id("\x01vorbis", 7);
+    PutUint32LE(id, 0);
+    id += (char) 2;
+    PutUint32LE(id, 44100);
+    PutUint32LE(id, 0);
+    PutUint32LE(id, 128000);
+    PutUint32LE(id, 0);
+    id += string("\xB8\x01", 2);
+    string comment("\x03vorbis", 7);
+    PutUint32LE(comment, 6);
+    comment += "iobenc";
+    PutUint32LE(comment, 0);
+    comment += (char) 1;
+    string setup = string("\x05vorbis", 7) + Random(64);
+
+    string s = OggPage({ id }, 0x02, 0, 0) + OggPage({ comment, setup }, 0x00, 0, 1);
+    size_t pages = size / 4000 + 1;
+    for (size_t i = 0; i < pages; i++) {
+        unsigned char type = (i + 1 == pages) ? 0x04 : 0x00;
+        s += OggPage({ Random(4000) }, type, (i + 1) * 4096, (uint32_t) (i + 2));
+    }
+    return s;
+}
+
+static string Base64(const TagLib::ByteVector &data) {
+    static const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string s;
+    const unsigned char *p = (const unsigned char *) data.data();
+    size_t n = data.size();
+    for (size_t i = 0; i < n; i += 3) {
+        uint32_t v = p[i] << 16 | (i + 1 < n ? p[i + 1] << 8 : 0) | (i + 2 < n ? p[i + 2] : 0);
+        s += alphabet[(v >> 18) & 63];
+        s += alphabet[(v >> 12) & 63];
+        s += (i + 1 < n) ? alphabet[(v >> 6) & 63] : '=';
+        s += (i + 2 < n) ? alphabet[v & 63] : '=';
+    }
+    return s;
+}
+
+static TagLib::FLAC::Picture *NewPicture(const Options &options) {
+    TagLib::FLAC::Picture *picture = new TagLib::FLAC::Picture();
+    picture->setType(TagLib::FLAC::Picture::FrontCover);
+    picture->setMimeType("image/jpeg");
+    picture->setData(Artwork(options.artwork));
+    return picture;
+}
+
+static void FillXiphComment(TagLib::Ogg::XiphComment *comment, const Options &options) {
+    comment->addField("TITLE", TagLib::String(Text(options.text), TagLib::String::UTF8));
+    for (size_t i = 1; i < options.frames; i++) {
+        comment->addField("BENCH" + TagLib::String::number((int) i), TagLib::String(Text(options.text), TagLib::String::UTF8));
+    }
+}
+
+static bool Synthesize(Format format, const string &path, const Options &options) {
+    switch (format) {
+        case FORMAT_MPEG: {
+            if (!WriteFile(path, MPEGAudio(options.audio))) return false;
+            TagLib::MPEG::File file(path.c_str(), false);
+            TagLib::ID3v2::Tag *tag = file.ID3v2Tag(true);
+            tag->setTitle(TagLib::String(Text(options.text), TagLib::String::UTF8));
+            for (size_t i = 1; i < options.frames; i++) {
+                auto frame = new TagLib::ID3v2::UserTextIdentificationFrame(TagLib::String::UTF8);
+                frame->setDescription("BENCH" + TagLib::String::number((int) i));
+                frame->setText(TagLib::String(Text(options.text), TagLib::String::UTF8));
+                tag->addFrame(frame);
+            }
+            if (options.artwork > 0) {
+                auto frame = new TagLib::ID3v2::AttachedPictureFrame();
+                frame->setType(TagLib::ID3v2::AttachedPictureFrame::FrontCover);
+                frame->setMimeType("image/jpeg");
+                frame->setPicture(Artwork(options.artwork));
+                tag->addFrame(frame);
+            }
+            return file.save(TagLib::MPEG::File::ID3v2, true, 4);
+        }
+        case FORMAT_FLAC: {
+            if (!WriteFile(path, FLACAudio(options.audio))) return false;
+            TagLib::FLAC::File file(path.c_str(), false);
+            FillXiphComment(file.xiphComment(true), options);
+            if (options.artwork > 0) file.addPicture(NewPicture(options));
+            return file.save();
+        }
+        case FORMAT_OGG: {
+            if (!WriteFile(path, OggAudio(options.audio))) return false;
+            TagLib::Vorbis::File file(path.c_str(), false);
+            FillXiphComment(file.tag(), options);
+            if (options.artwork > 0) {
+                TagLib::FLAC::Picture *picture = NewPicture(options);
+                file.tag()->addField("METADATA_BLOCK_PICTURE", Base64(picture->render()));
+                delete picture;
+            }
+            return file.save();
+        }
+    }
+    return false;
+}
+
+
+// -- operations ----------------------------------------------------------
+
+enum Operation { OPERATION_READ, OPERATION_CACHED, OPERATION_EXTRACT, OPERATION_WRITE };
+static const char *OPERATION_NAMES[] = { "read", "cached", "extract", "write" };
+
+// Configuration of the requests - defaults of tagio except attachments, cache and
+// written tags (only the ones the write request has).
+static void Configure(Configuration *conf, Format format, Operation operation, const string &dir) {
+    conf->SetFileExtracted(FILE_EXTRACTED_IS_IGNORED);
+    switch (operation) {
+        case OPERATION_READ:
+            break;
+        case OPERATION_CACHED:
+            conf->SetCacheDirectory(TagLib::String(dir + "/cache", TagLib::String::UTF8));
+            break;
+        case OPERATION_EXTRACT:
+            conf->SetFileExtracted(FILE_EXTRACTED_AS_FILENAME);
+            conf->SetFileDirectory(TagLib::String(dir + "/extracted", TagLib::String::UTF8));
+            break;
+        case OPERATION_WRITE:
+            conf->SetID3v1Writable(false);
+            conf->SetID3v2Writable(format == FORMAT_MPEG);
+            break;
+    }
+}
+
+// Size of the serialized response keeps the work from being optimized away.
+static size_t ResultSize(const Result &result) {
+    string out;
+    result.Serialize(out);
+    return out.size();
+}
+
+static size_t ReadFile(const string &path, Configuration *conf) {
+    std::unique_ptr<Reader> reader(NewReader(path, conf));
+    Result result = Result::Object();
+    reader->Read(&result);
+    return ResultSize(result);
+}
+
+// Tags of a write request as the imports build them - the full tag replaces the
+// old one, its title alternates in length so every save changes the file.
+struct WriteRequest {
+    TagLib::ID3v1::Tag id3v1Tag;
+    TagLib::ID3v2::Tag id3v2Tag;
+    TagLib::APE::Tag apeTag;
+    TagLib::Ogg::XiphComment xiphComment;
+    vector<TagLib::FLAC::Picture *> pictures;
+    map<uintptr_t, string> fmap;
+
+    WriteRequest(Format format, const Options &options, size_t round) {
+        TagLib::String title = (round % 2 == 0) ? "Benchmark" : "Benchmark Title Written Again";
+        if (format == FORMAT_MPEG) {
+            id3v2Tag.setTitle(title);
+            for (size_t i = 1; i < options.frames; i++) {
+                auto frame = new TagLib::ID3v2::UserTextIdentificationFrame(TagLib::String::UTF8);
+                frame->setDescription("BENCH" + TagLib::String::number((int) i));
+                frame->setText(TagLib::String(Text(options.text), TagLib::String::UTF8));
+                id3v2Tag.addFrame(frame);
+            }
+            if (options.artwork > 0) {
+                auto frame = new TagLib::ID3v2::AttachedPictureFrame();
+                frame->setType(TagLib::ID3v2::AttachedPictureFrame::FrontCover);
+                frame->setMimeType("image/jpeg");
+                frame->setPicture(Artwork(options.artwork));
+                id3v2Tag.addFrame(frame);
+            }
+        } else {
+            FillXiphComment(&xiphComment, options);
+            xiphComment.addField("TITLE", title, true);
+            if (options.artwork > 0 && format == FORMAT_FLAC) pictures.push_back(NewPicture(options));
+            if (options.artwork > 0 && format == FORMAT_OGG) {
+                std::unique_ptr<TagLib::FLAC::Picture> picture(NewPicture(options));
+                xiphComment.addField("METADATA_BLOCK_PICTURE", Base64(picture->render()));
+            }
+        }
+    }
+
+    // pictures not added to the file
+    ~WriteRequest() {
+        for (auto picture : pictures) delete picture;
+    }
+};
+
+static size_t WriteTags(Format format, const string &path, Configuration *conf, WriteRequest *request) {
+    Result result = Result::Object();
+    switch (format) {
+        case FORMAT_MPEG:
+            WriteMPEGFile(path, conf, &request->id3v1Tag, &request->id3v2Tag, &request->apeTag, request->fmap, false, &result);
+            break;
+        case FORMAT_FLAC:
+            WriteFLACFile(path, conf, &request->id3v1Tag, &request->id3v2Tag, &request->xiphComment, &request->pictures,
+                          request->fmap, false, &result);
+            break;
+        case FORMAT_OGG:
+            WriteOggFile(path, conf, &request->xiphComment, false, &result);
+            break;
+    }
+    return ResultSize(result);
+}
+
+
+// -- measurement ---------------------------------------------------------
+
+static double PeakRSS() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);     // bytes
+#else
+    return usage.ru_maxrss / 1024.0;                // kilobytes
+#endif
+}
+
+static uint64_t FileSize(const string &path) {
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0) ? (uint64_t) st.st_size : 0;
+}
+
+static double Percentile(vector<double> &latencies, double p) {
+    if (latencies.empty()) return 0;
+    size_t index = std::min(latencies.size() - 1, (size_t) (p * latencies.size()));
+    std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    return latencies[index];
+}
+
+static void Measure(Format format, Operation operation, const vector<string> &paths, const Options &options) {
+    typedef std::chrono::steady_clock clock;
+    Configuration conf;
+    Configure(&conf, format, operation, options.dir);
+    vector<double> latencies;
+    uint64_t bytes = 0;
+    size_t work = 0;
+    double total = 0;
+    for (size_t round = 0; round < options.rounds; round++) {
+        for (const string &path : paths) {
+            bytes += FileSize(path);
+            std::unique_ptr<WriteRequest> request;
+            if (operation == OPERATION_WRITE) request.reset(new WriteRequest(format, options, round));
+            clock::time_point start = clock::now();
+            if (operation == OPERATION_WRITE) {
+                work += WriteTags(format, path, &conf, request.get());
+            } else {
+                work += ReadFile(path, &conf);
+            }
+            double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            latencies.push_back(elapsed * 1000);
+            total += elapsed;
+        }
+    }
+    size_t count = latencies.size();
+    printf("%-6s %-8s %8zu %10.1f %10.1f %9.3f %9.3f %10.1f%s\n",
+           FORMAT_NAMES[format], OPERATION_NAMES[operation], count,
+           count / total, bytes / total / (1024 * 1024),
+           Percentile(latencies, 0.5), Percentile(latencies, 0.99), PeakRSS(),
+           work == 0 ? "  (nothing read)" : "");
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = (eq == string::npos) ? "" : arg.substr(eq + 1);
+        if (key == "--files") options.files = strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--frames") options.frames = strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--text") options.text = strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--artwork") options.artwork = strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--audio") options.audio = strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--rounds") options.rounds = strtoul(value.c_str(), nullptr, 10);
+        else if (key == "--dir") options.dir = value;
+        else if (key == "--keep") options.keep = true;
+        else return false;
+    }
+    return options.files > 0 && options.rounds > 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--files=N] [--frames=N] [--text=BYTES] [--artwork=BYTES] "
+                        "[--audio=BYTES] [--rounds=N] [--dir=PATH] [--keep]\n", argv[0]);
+        return 2;
+    }
+    bool temporary = options.dir.empty();
+    if (temporary) {
+        char pattern[] = "/tmp/iobench.XXXXXX";
+        if (mkdtemp(pattern) == nullptr) {
+            perror("mkdtemp");
+            return 1;
+        }
+        options.dir = pattern;
+    }
+    string extract = options.dir + "/extracted";
+    string cache = options.dir + "/cache";
+
+    printf("%zu files per format, %zu frames of %zu bytes, artwork %zu bytes, audio %zu bytes, %zu rounds\n",
+           options.files, options.frames, options.text, options.artwork, options.audio, options.rounds);
+    printf("%-6s %-8s %8s %10s %10s %9s %9s %10s\n",
+           "format", "op", "files", "files/s", "MB/s", "p50 ms", "p99 ms", "peak MB");
+
+    vector<string> created;
+    Format formats[] = { FORMAT_MPEG, FORMAT_FLAC, FORMAT_OGG };
+    for (Format format : formats) {
+        vector<string> paths;
+        for (size_t i = 0; i < options.files; i++) {
+            string path = options.dir + "/" + FORMAT_NAMES[format] + std::to_string(i) + FORMAT_EXTENSIONS[format];
+            if (!Synthesize(format, path, options)) {
+                fprintf(stderr, "can not create %s\n", path.c_str());
+                return 1;
+            }
+            paths.push_back(path);
+        }
+        Measure(format, OPERATION_READ, paths, options);
+        Measure(format, OPERATION_CACHED, paths, options);
+        Measure(format, OPERATION_EXTRACT, paths, options);
+        Measure(format, OPERATION_WRITE, paths, options);
+        created.insert(created.end(), paths.begin(), paths.end());
+    }
+
+    if (!options.keep) {
+        for (const string &path : created) remove(path.c_str());
+        string command = temporary ? "rm -rf '" + options.dir + "'" : "rm -rf '" + extract + "' '" + cache + "'";
+        if (system(command.c_str()) != 0) fprintf(stderr, "can not remove %s\n", command.c_str() + 7);
+    }
+    return 0;
+}
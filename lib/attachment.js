@@ -0,0 +1,83 @@
+"use strict";
+var fs = require("fs");
+var stream = require("stream");
+
+// Frame properties holding attached data.
+var ATTACHMENT_KEYS = ["picture", "object", "identifier"];
+
+/**
+ * Attached data left in the audio file - read returns it instead of the data
+ * when fileExtracted is AS_HANDLE. Size and mimeType describe the data, offset
+ * and length locate it in the file. Data not stored as is (e.g. compressed frame)
+ * is carried by the handle itself. Handle is valid until the file is written.
+ */
+function Attachment(file, handle) {
+    this.path = file;
+    this.size = handle.size;
+    this.mimeType = handle.mimeType;
+    this.offset = handle.offset;
+    this.length = handle.length;
+    this.data = handle.data;
+}
+
+/**
+ * Reads the data - promise resolves with Buffer.
+ */
+Attachment.prototype.load = function () {
+    var self = this;
+    if (self.data) return Promise.resolve(self.data);
+    return new Promise(function (resolve, reject) {
+        fs.open(self.path, "r", function (err, fd) {
+            if (err) return reject(err);
+            var buffer = Buffer.alloc(self.length);
+            fs.read(fd, buffer, 0, self.length, self.offset, function (err, bytesRead) {
+                fs.close(fd, function () {});
+                if (err) reject(err);
+                else if (bytesRead !== self.length) reject("File '" + self.path + "' was changed");
+                else resolve(buffer);
+            });
+        });
+    });
+};
+
+/**
+ * Streams the data to writable stream, returns the destination.
+ */
+Attachment.prototype.pipe = function (destination, options) {
+    var source;
+    if (this.data || !this.length) {
+        source = new stream.PassThrough();
+        source.end(this.data || Buffer.alloc(0));
+    } else {
+        source = fs.createReadStream(this.path, { start: this.offset, end: this.offset + this.length - 1 });
+    }
+    return source.pipe(destination, options);
+};
+
+var wrapFrames = function (file, frames) {
+    if (!Array.isArray(frames)) return;
+    frames.forEach(function (frame) {
+        ATTACHMENT_KEYS.forEach(function (key) {
+            var value = frame[key];
+            if (value && typeof value === "object" && !Buffer.isBuffer(value))
+                frame[key] = new Attachment(file, value);
+        });
+    });
+};
+
+/**
+ * Replaces attachment handles of read result by Attachment objects.
+ */
+var wrapAttachments = function (result) {
+    if (result && result.path) {
+        wrapFrames(result.path, result.id3v2);
+        wrapFrames(result.path, result.pictures);
+        wrapFrames(result.path, result.mp4);
+    }
+    return result;
+};
+
+module.exports = {
+    Attachment: Attachment,
+    wrapAttachments: wrapAttachments
+};
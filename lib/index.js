@@ -1,6 +1,7 @@
 const fs = require("fs");
 const path = require("path");
 const id3v2 = require("./id3v2");
+const attachment = require("./attachment");
 const tagioPlugin = require("../build/Release/tagio");
 const os = require("os");
 var Validator = require('jsonschema').Validator;
@@ -16,7 +17,25 @@ var FileExtracted = {
     IS_IGNORED: "IS_IGNORED",
     AS_FILENAME: "AS_FILENAME",
     AS_ABSOLUTE_URL: "AS_ABSOLUTE_URL",
-    AS_RELATIVE_URL: "AS_RELATIVE_URL"
+    AS_RELATIVE_URL: "AS_RELATIVE_URL",
+    AS_BUFFER: "AS_BUFFER",
+    AS_HANDLE: "AS_HANDLE"
+};
+
+var FileHash = {
+    XXH3: "XXH3",
+    MD5: "MD5"
+};
+
+var Priority = {
+    INTERACTIVE: "INTERACTIVE",
+    BULK: "BULK"
+};
+
+var AudioPropertiesStyle = {
+    FAST: "FAST",
+    AVERAGE: "AVERAGE",
+    ACCURATE: "ACCURATE"
 };
 
 var Encoding = {
@@ -30,10 +49,15 @@ var Encoding = {
 const defaultConfiguration = {
     fileExtracted: FileExtracted.AS_FILENAME,
     fileDirectory: os.tmpdir(),
+    fileHash: FileHash.XXH3,
     fileUrlPrefix: "/attachments",
+    cacheDirectory: "",
+    importCacheSize: 67108864,
     configurationReadable: false,
     audioPropertiesReadable: false,
+    audioPropertiesStyle: AudioPropertiesStyle.AVERAGE,
     tagReadable: false,
+    timingsReadable: false,
     apeWritable: true,
     apeReadable: true,
     id3v1Writable: true,
@@ -44,8 +68,15 @@ const defaultConfiguration = {
     id3v2Encoding: Encoding.UTF8,
     id3v2Version: 4,
     id3v2UseFrameEncoding: false,
+    id3v2Padding: 4096,
     xiphCommentReadable: true,
-    xiphCommentWritable: true
+    xiphCommentWritable: true,
+    xiphCommentPadding: 4096,
+    mp4Readable: true,
+    mp4Writable: true,
+    threads: 0,
+    queueSize: 256,
+    queueLimit: 4096
 };
 
 var configuration = Object.assign({}, defaultConfiguration);
@@ -68,6 +99,12 @@ var checkDirectory = function(d) {
     return d;
 };
 
+var checkFields = function(fields) {
+    if (!Array.isArray(fields) || !fields.every(function (f) { return typeof f === 'string'; }))
+        throw "Fields - must be array of strings";
+    return fields;
+};
+
 var getID3v2Schema = function (id) {
     if (!id3v2schemas) {
         id3v2schemas = {};
@@ -106,20 +143,92 @@ var checkData = function (request, ext) {
     }
 };
 
+var PatchOperations = ["set", "remove", "append"];
+
+var checkID3v2Frame = function (frame, index, key) {
+    const schema = getID3v2Schema(frame.id);
+    if (!schema) return "Unsupported " + key + "[" + index + "] - " + frame.id;
+    var result = validator.validate(frame, schema);
+    return (result.errors.length > 0) ? "Invalid " + key + "[" + index + "] - " + frame.id + " - " + result.errors : null;
+};
+
+// Operations of patch request - set and append frames are validated as frames of write.
+var checkPatch = function (request) {
+    var check = function (key, operations, validate) {
+        if (operations === undefined) return null;
+        if (!Array.isArray(operations)) return "Invalid " + key + " - must be array of operations";
+        return operations.reduce(function (err, operation, index) {
+            if (err != null) return err; // only first returned
+            if (PatchOperations.indexOf(operation.op) < 0) return "Invalid " + key + "[" + index + "] - unknown op " + operation.op;
+            if (typeof operation.id !== 'string') return "Invalid " + key + "[" + index + "] - missing id";
+            return (operation.op === "remove") ? null : validate(operation, index);
+        }, null);
+    };
+    return check("id3v2", request.id3v2, function (frame, index) {
+        return checkID3v2Frame(frame, index, "id3v2");
+    }) || check("xiphComment", request.xiphComment, function (field, index) {
+        return (typeof field.text !== 'string') ? "Invalid xiphComment[" + index + "] - missing text" : null;
+    });
+};
+
 var checkConfiguration = function(c) {
     c = Object.assign({}, configuration, c);
     validator.validate(c, configurationSchema);
     c.fileDirectory = checkDirectory(c.fileDirectory);
+    if (c.cacheDirectory) c.cacheDirectory = checkDirectory(c.cacheDirectory);
     return c;
 };
 
 
+/**
+ * Native requests are executed on tagio's own thread pool. At most queueSize
+ * requests are handed over to it at once, the others wait here and interactive
+ * ones are dispatched first - promise of waiting request is simply pending.
+ * When queueLimit requests are waiting, a new one is rejected by reject.
+ * Requests of scan are not rejected, scan bounds them by its prefetch.
+ */
+var waiting = { INTERACTIVE: [], BULK: [] };
+var SCAN_DIRECTORIES = 64; // directories handed over to one native listing
+var running = 0;
+
+var dispatch = function () {
+    while (running < configuration.queueSize) {
+        var job = waiting.INTERACTIVE.shift() || waiting.BULK.shift();
+        if (!job) return;
+        running++;
+        job(function () {
+            running--;
+            dispatch();
+        });
+    }
+};
+
+var schedule = function (priority, job, reject) {
+    if (reject && waiting.INTERACTIVE.length + waiting.BULK.length >= configuration.queueLimit)
+        return reject("Request queue full");
+    waiting[priority === Priority.BULK ? Priority.BULK : Priority.INTERACTIVE].push(job);
+    dispatch();
+};
+
+// Attachment handles of AS_HANDLE results get load() and pipe().
+var handled = function (conf, response) {
+    if (conf.fileExtracted !== FileExtracted.AS_HANDLE) return response;
+    return attachment.wrapAttachments(response);
+};
+
 var getNativeReadMethod = function (ext) {
     switch (ext) {
         case ".mp3":
             return tagioPlugin.readMPEG;
         case ".flac":
             return tagioPlugin.readFLAC;
+        case ".ogg":
+        case ".opus":
+            return tagioPlugin.readOgg;
+        case ".m4a":
+        case ".m4b":
+        case ".mp4":
+            return tagioPlugin.readMP4;
         default:
             return tagioPlugin.readGeneric;
     }
@@ -131,22 +240,47 @@ var getNativeWriteMethod = function (ext) {
             return tagioPlugin.writeMPEG;
         case ".flac":
             return tagioPlugin.writeFLAC;
+        case ".ogg":
+        case ".opus":
+            return tagioPlugin.writeOgg;
+        case ".m4a":
+        case ".m4b":
+        case ".mp4":
+            return tagioPlugin.writeMP4;
         default:
             return tagioPlugin.writeGeneric;
     }
 };
 
+var getNativePatchMethod = function (ext) {
+    switch (ext) {
+        case ".mp3":
+            return tagioPlugin.patchMPEG;
+        case ".flac":
+            return tagioPlugin.patchFLAC;
+        case ".ogg":
+        case ".opus":
+            return tagioPlugin.patchOgg;
+        default:
+            return null;
+    }
+};
+
 
 var read = function(request) {
     return new Promise(function(resolve, reject) {
         request.path = checkPath(request.path);
         request.configuration = checkConfiguration(request.configuration);
-        var ext = path.extname(request.path);
+        if (request.fields !== undefined) request.fields = checkFields(request.fields);
+        var ext = path.extname(request.path).toLowerCase();
         var nativeRead = getNativeReadMethod(ext);
-        nativeRead(request, function (err, response) {
-            if (err) reject(err);
-            else resolve(response);
-        });
+        schedule(request.priority, function (done) {
+            nativeRead(request, function (err, response) {
+                done();
+                if (err) reject(err);
+                else resolve(handled(request.configuration, response));
+            });
+        }, reject);
     });
 };
 
@@ -155,28 +289,282 @@ var write =function (request) {
         request.path = checkPath(request.path);
         request.configuration = checkConfiguration(request.configuration);
         //console.log(request);
-        var ext = path.extname(request.path);
+        var ext = path.extname(request.path).toLowerCase();
         var err = checkData(request, ext);
         if (err) reject(err);
         var nativeWrite = getNativeWriteMethod(ext);
-        nativeWrite(request, function (err, response) {
-            if (err) reject(err);
-            else resolve(response);
+        schedule(request.priority, function (done) {
+            nativeWrite(request, function (err, response) {
+                done();
+                if (err) reject(err);
+                else resolve(handled(request.configuration, response));
+            });
+        }, reject);
+    });
+};
+
+/**
+ * Changes only the frames (Xiph comment fields) named by operations of
+ * request.id3v2 (request.xiphComment), the other ones are kept as they are:
+ * { op: "set", id: "TIT2", text: "..." } replaces all frames of the ID,
+ * { op: "remove", id: "COMM" } removes them and { op: "append", ... } adds
+ * the frame. TXXX and WXXX frames are matched by their description too.
+ * File which would not change is not written - response.changed is false.
+ */
+var patch = function (request) {
+    return new Promise(function(resolve, reject) {
+        request.path = checkPath(request.path);
+        request.configuration = checkConfiguration(request.configuration);
+        var ext = path.extname(request.path).toLowerCase();
+        var nativePatch = getNativePatchMethod(ext);
+        if (!nativePatch) return reject("Unsupported file - " + ext);
+        var err = checkPatch(request);
+        if (err) return reject(err);
+        schedule(request.priority, function (done) {
+            nativePatch(request, function (err, response) {
+                done();
+                if (err) reject(err);
+                else resolve(handled(request.configuration, response));
+            });
+        }, reject);
+    });
+};
+
+/**
+ * Reads many files in one native call. Files are read in parallel and
+ * results are delivered in chunks - when onChunk is given it receives each
+ * chunk and promise resolves with number of files, otherwise promise resolves
+ * with all results. Unreadable files are reported with error property.
+ * Runs with bulk priority unless options.priority says otherwise,
+ * options.fields limits the results the same way as fields of read request.
+ */
+var readMany = function (paths, conf, onChunk, options) {
+    return new Promise(function(resolve, reject) {
+        options = options || {};
+        var results = [];
+        var request = {
+            paths: paths.map(function (p) { return path.resolve(p); }),
+            configuration: checkConfiguration(conf),
+            chunkSize: options.chunkSize || 0,
+            concurrency: options.concurrency || 0,
+            priority: options.priority || Priority.BULK
+        };
+        if (options.fields !== undefined) request.fields = checkFields(options.fields);
+        var chunk = function (responses) {
+            responses.forEach(function (response) { handled(request.configuration, response); });
+            if (onChunk) onChunk(responses);
+            else Array.prototype.push.apply(results, responses);
+        };
+        schedule(request.priority, function (done) {
+            tagioPlugin.readMany(request, chunk, function (err, count) {
+                done();
+                if (err) reject(err);
+                else resolve(onChunk ? count : results);
+            });
+        }, reject);
+    });
+};
+
+/**
+ * Writes many files (e.g. an album) in one native call - files are written in
+ * parallel and promise resolves with their responses in order of the files.
+ * Attachments of request.shared are read and rendered once, id3v2 frames are
+ * set to every MP3 file and pictures to every FLAC file. Each of request.files
+ * gives its path and its own changes as operations of patch request (id3v2,
+ * xiphComment), applied after the shared ones. Files which would not change
+ * are not written, a file must not be listed twice.
+ */
+var writeMany = function (request) {
+    return new Promise(function(resolve, reject) {
+        request.configuration = checkConfiguration(request.configuration);
+        if (!Array.isArray(request.files)) return reject("Files - must be array");
+        var shared = request.shared || {};
+        var err = (shared.id3v2 || []).reduce(function (err, frame, index) {
+            return err || checkID3v2Frame(frame, index, "shared.id3v2");
+        }, null);
+        if (!err && shared.pictures !== undefined && !Array.isArray(shared.pictures)) err = "Invalid shared.pictures - must be array";
+        var paths = {};
+        request.files.forEach(function (file, index) {
+            if (err) return;
+            file.path = checkPath(file.path);
+            var ext = path.extname(file.path).toLowerCase();
+            if (ext !== ".mp3" && ext !== ".flac") err = "Unsupported file - " + file.path;
+            else if (paths[fs.realpathSync(file.path)]) err = "Duplicate file - " + file.path;
+            else {
+                paths[fs.realpathSync(file.path)] = true;
+                err = checkPatch(file);
+                if (err) err = "files[" + index + "] - " + err;
+            }
         });
+        if (err) return reject(err);
+        schedule(request.priority, function (done) {
+            tagioPlugin.writeMany(request, function (err, responses) {
+                done();
+                if (err) reject(err);
+                else resolve(responses.map(function (response) { return handled(request.configuration, response); }));
+            });
+        }, reject);
+    });
+};
+
+/**
+ * Walks directory tree natively and reads all files tagio can read.
+ * Returns async iterator of result batches - arrays of at most batchSize
+ * results. Listing and reading run ahead of the consumer by at most prefetch
+ * batches, so memory stays flat on large trees. Files are not ordered,
+ * unreadable files and directories are reported with error property.
+ * Options: configuration, batchSize (64), prefetch (2), concurrency,
+ * extensions (e.g. [".mp3"], all readable formats by default), fields and
+ * priority (bulk by default).
+ */
+var scan = function (rootDir, options) {
+    options = options || {};
+    var conf = checkConfiguration(options.configuration);
+    var batchSize = options.batchSize || 64;
+    var prefetch = options.prefetch || 2;
+    var priority = options.priority || Priority.BULK;
+    var fields = (options.fields !== undefined) ? checkFields(options.fields) : undefined;
+    var extensions = options.extensions && options.extensions.map(function (e) {
+        e = String(e).toLowerCase();
+        return (e[0] === ".") ? e : "." + e;
     });
+
+    var directories = [checkDirectory(rootDir)];
+    var files = [];     // listed, not read yet
+    var ready = [];     // batches waiting for the consumer
+    var waiters = [];   // pending next() calls
+    var reading = 0;
+    var listing = false;
+    var closed = false;
+    var failure = null;
+
+    var finished = function () {
+        return closed || (directories.length === 0 && files.length === 0 && reading === 0 && !listing);
+    };
+
+    var deliver = function () {
+        while (waiters.length > 0) {
+            if (failure) waiters.shift().reject(failure);
+            else if (ready.length > 0) waiters.shift().resolve({ value: ready.shift(), done: false });
+            else if (finished()) waiters.shift().resolve({ value: undefined, done: true });
+            else break;
+        }
+    };
+
+    var listFiles = function () {
+        listing = true;
+        var request = {
+            directories: directories.splice(-SCAN_DIRECTORIES, SCAN_DIRECTORIES),
+            limit: batchSize * prefetch,
+            priority: priority
+        };
+        if (extensions) request.extensions = extensions;
+        schedule(priority, function (done) {
+            tagioPlugin.listDirectories(request, function (err, response) {
+                done();
+                listing = false;
+                if (err) failure = err;
+                else if (!closed) {
+                    Array.prototype.push.apply(directories, response.directories);
+                    Array.prototype.push.apply(files, response.files);
+                    if (response.errors.length > 0) ready.push(response.errors.map(function (d) {
+                        return { path: d, error: "Unable to list directory" };
+                    }));
+                }
+                pump();
+            });
+        });
+    };
+
+    var readFiles = function (paths) {
+        reading++;
+        var results = [];
+        var request = {
+            paths: paths,
+            configuration: conf,
+            chunkSize: paths.length,
+            concurrency: options.concurrency || 0,
+            priority: priority
+        };
+        if (fields) request.fields = fields;
+        schedule(priority, function (done) {
+            tagioPlugin.readMany(request, function (chunk) {
+                chunk.forEach(function (response) { handled(conf, response); });
+                Array.prototype.push.apply(results, chunk);
+            }, function (err) {
+                done();
+                reading--;
+                if (err) failure = err;
+                else if (!closed) ready.push(results);
+                pump();
+            });
+        });
+    };
+
+    var pump = function () {
+        if (!closed && !failure) {
+            while (ready.length + reading < prefetch &&
+                   (files.length >= batchSize || (files.length > 0 && directories.length === 0 && !listing)))
+                readFiles(files.splice(0, batchSize));
+            if (!listing && directories.length > 0 && files.length < batchSize * prefetch) listFiles();
+        }
+        deliver();
+    };
+
+    var iterator = {
+        next: function () {
+            return new Promise(function (resolve, reject) {
+                waiters.push({ resolve: resolve, reject: reject });
+                pump();
+            });
+        },
+        return: function () {
+            closed = true;
+            directories = [];
+            files = [];
+            ready = [];
+            deliver();
+            return Promise.resolve({ value: undefined, done: true });
+        }
+    };
+    if (typeof Symbol === "function" && Symbol.asyncIterator)
+        iterator[Symbol.asyncIterator] = function () { return iterator; };
+    pump();
+    return iterator;
+};
+
+/**
+ * Per phase count, nanoseconds, bytes and histogram of all requests read or
+ * written with timingsReadable - histogram[0] counts phases shorter than 2
+ * microseconds, histogram[i] those from 2^i to 2^(i+1) microseconds.
+ * Collected values are cleared when reset is true.
+ */
+var stats = function (reset) {
+    return tagioPlugin.stats(!!reset);
 };
 
 var configure = function (conf) {
     if (!conf) configuration = checkConfiguration(defaultConfiguration);
     else configuration = checkConfiguration(conf);
+    tagioPlugin.configurePool(configuration.threads);
+    dispatch(); // queue may have grown
     return configuration;
 };
 
 module.exports = {
     configure: configure,
     read: read,
+    readMany: readMany,
+    scan: scan,
     write: write,
+    writeMany: writeMany,
+    patch: patch,
+    stats: stats,
     id3v2: id3v2,
     Encoding: Encoding,
-    FileExtracted: FileExtracted
+    AudioPropertiesStyle: AudioPropertiesStyle,
+    FileExtracted: FileExtracted,
+    Attachment: attachment.Attachment,
+    FileHash: FileHash,
+    Priority: Priority
 };
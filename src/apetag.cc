@@ -1,24 +1,13 @@
 #include "apetag.h"
 #include "wrapper.h"
 
-void ExportAPETag(TagLib::APE::Tag *tag, v8::Object *object) {
+void ExportAPETag(TagLib::APE::Tag *tag, Result *object, const Projection &fields) {
     TagLibWrapper o(object);
-    o.SetString("title", tag->title());
-    o.SetString("album", tag->album());
-    o.SetString("artist", tag->artist());
-    o.SetUint32("track", tag->track());
-    o.SetUint32("year", tag->year());
-    o.SetString("genre", tag->genre());
-    o.SetString("comment", tag->comment());
+    if (fields.Has("title")) o.SetString("title", tag->title());
+    if (fields.Has("album")) o.SetString("album", tag->album());
+    if (fields.Has("artist")) o.SetString("artist", tag->artist());
+    if (fields.Has("track")) o.SetUint32("track", tag->track());
+    if (fields.Has("year")) o.SetUint32("year", tag->year());
+    if (fields.Has("genre")) o.SetString("genre", tag->genre());
+    if (fields.Has("comment")) o.SetString("comment", tag->comment());
 }
-
-void ImportAPETag(v8::Object *object, TagLib::APE::Tag *tag) {
-    TagLibWrapper o(object);
-    tag->setTitle(o.GetString("title"));
-    tag->setAlbum(o.GetString("album"));
-    tag->setArtist(o.GetString("artist"));
-    tag->setTrack(o.GetUint32("track"));
-    tag->setYear(o.GetUint32("year"));
-    tag->setGenre(o.GetString("genre"));
-    tag->setComment(o.GetString("comment"));
-}
\ No newline at end of file
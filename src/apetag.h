@@ -1,10 +1,11 @@
 #ifndef TAGIO_APETAG_H
 #define TAGIO_APETAG_H
 
-#include <node.h>
 #include <taglib/apetag.h>
+#include "result.h"
+#include "projection.h"
 
-void ExportAPETag(TagLib::APE::Tag *tag, v8::Object *object);
+void ExportAPETag(TagLib::APE::Tag *tag, Result *object, const Projection &fields);
 void ImportAPETag(v8::Object *object, TagLib::APE::Tag *tag);
 
 #endif //TAGIO_APETAG_H
@@ -0,0 +1,228 @@
+#include "attachment.h"
+#include "mp4atom.h"
+
+#include <fstream>
+#include <vector>
+#include <taglib/attachedpictureframe.h>
+#include <taglib/generalencapsulatedobjectframe.h>
+#include <taglib/id3v2header.h>
+
+using namespace std;
+
+const size_t FRAME_PREFIX_LIMIT = 1024; // mime type, file name and description of located frame
+
+struct RawFrame {
+    bool located;
+    AttachmentLocation location;
+};
+
+static uint32_t ReadSize(const unsigned char *p, bool syncSafe) {
+    if (syncSafe)
+        return ((uint32_t) (p[0] & 0x7F) << 21) | ((uint32_t) (p[1] & 0x7F) << 14) |
+               ((uint32_t) (p[2] & 0x7F) << 7) | (uint32_t) (p[3] & 0x7F);
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+// Position after zero terminated string in the encoding, 0 when terminator is missing.
+static size_t SkipString(const vector<unsigned char> &data, size_t i, unsigned char encoding) {
+    if (encoding == 1 || encoding == 2) { // UTF-16 - terminated by aligned pair of zeros
+        for (; i + 1 < data.size(); i += 2)
+            if (data[i] == 0 && data[i + 1] == 0) return i + 2;
+        return 0;
+    }
+    for (; i < data.size(); i++)
+        if (data[i] == 0) return i + 1;
+    return 0;
+}
+
+// Length of encoding, mime type, picture type/file name and description preceding the data.
+static size_t DataPrefix(const vector<unsigned char> &data, bool picture) {
+    if (data.empty()) return 0;
+    unsigned char encoding = data[0];
+    size_t i = SkipString(data, 1, 0); // mime type is always latin1
+    if (i == 0) return 0;
+    if (picture) {
+        i++; // picture type
+    } else {
+        i = SkipString(data, i, encoding); // file name
+        if (i == 0) return 0;
+    }
+    if (i > data.size()) return 0;
+    return SkipString(data, i, encoding); // description
+}
+
+static bool ReadAt(ifstream &ifs, uint64_t offset, unsigned char *buffer, size_t length) {
+    ifs.clear();
+    ifs.seekg((streamoff) offset);
+    ifs.read(reinterpret_cast<char *>(buffer), (streamsize) length);
+    return ifs.good();
+}
+
+void AttachmentSource::Locate(const string &path, TagLib::ID3v2::Tag *tag) {
+    const TagLib::ID3v2::Header *header = tag->header();
+    if (header->majorVersion() < 3 || header->unsynchronisation()) return;
+
+    ifstream ifs;
+    ifs.open(path, ios::in | ios::binary);
+    if (!ifs.is_open()) return;
+
+    // tag must be the one TagLib has read - at the start of the file
+    unsigned char h[10];
+    if (!ReadAt(ifs, 0, h, 10) || h[0] != 'I' || h[1] != 'D' || h[2] != '3') return;
+    if (h[3] != header->majorVersion() || ReadSize(h + 6, true) != header->tagSize()) return;
+    const bool v4 = h[3] == 4;
+
+    uint64_t position = 10;
+    const uint64_t end = 10 + (uint64_t) header->tagSize();
+    if (h[5] & 0x40) { // extended header
+        unsigned char e[4];
+        if (!ReadAt(ifs, position, e, 4)) return;
+        position += v4 ? ReadSize(e, true) : 4 + ReadSize(e, false);
+    }
+
+    vector<RawFrame> pictures, objects;
+    vector<unsigned char> prefix;
+    while (position + 10 <= end) {
+        unsigned char f[10];
+        if (!ReadAt(ifs, position, f, 10) || f[0] == 0) break; // padding
+        uint64_t size = ReadSize(f + 4, v4);
+        uint64_t dataStart = position + 10;
+        position = dataStart + size;
+        if (position > end) break;
+
+        bool picture = f[0] == 'A' && f[1] == 'P' && f[2] == 'I' && f[3] == 'C';
+        bool object = f[0] == 'G' && f[1] == 'E' && f[2] == 'O' && f[3] == 'B';
+        if (!picture && !object) continue;
+
+        RawFrame raw = { false, { 0, 0 } };
+        bool stored = v4 ? (f[9] & 0x0E) == 0 : (f[9] & 0xC0) == 0; // not compressed, encrypted, unsynchronised
+        uint64_t skip = v4 ? ((f[9] & 0x40) ? 1 : 0) + ((f[9] & 0x01) ? 4 : 0) : ((f[9] & 0x20) ? 1 : 0);
+        if (stored && skip < size) {
+            prefix.resize((size_t) min<uint64_t>(size - skip, FRAME_PREFIX_LIMIT));
+            if (ReadAt(ifs, dataStart + skip, prefix.data(), prefix.size())) {
+                size_t length = DataPrefix(prefix, picture);
+                if (length > 0 && length <= size - skip) {
+                    raw.located = true;
+                    raw.location.offset = dataStart + skip + length;
+                    raw.location.length = size - skip - length;
+                }
+            }
+        }
+        (picture ? pictures : objects).push_back(raw);
+    }
+
+    size_t nextPicture = 0, nextObject = 0;
+    TagLib::ID3v2::FrameList frameList = tag->frameList();
+    for (auto it = frameList.begin(); it != frameList.end(); it++) {
+        const RawFrame *raw = nullptr;
+        uint64_t size = 0;
+        if (auto *p = dynamic_cast<TagLib::ID3v2::AttachedPictureFrame *>(*it)) {
+            if (nextPicture < pictures.size()) raw = &pictures[nextPicture++];
+            size = p->picture().size();
+        } else if (auto *o = dynamic_cast<TagLib::ID3v2::GeneralEncapsulatedObjectFrame *>(*it)) {
+            if (nextObject < objects.size()) raw = &objects[nextObject++];
+            size = o->object().size();
+        }
+        if (raw != nullptr && raw->located && raw->location.length == size)
+            locations[*it] = raw->location;
+    }
+}
+
+static uint32_t ReadUint32(ifstream &ifs, uint64_t offset, bool *ok) {
+    unsigned char b[4] = { 0, 0, 0, 0 };
+    *ok = *ok && ReadAt(ifs, offset, b, 4);
+    return ReadSize(b, false);
+}
+
+// Metadata blocks follow "fLaC" which follows ID3v2 tag if there is one (as TagLib reads it).
+void AttachmentSource::Locate(const string &path, const TagLib::List<TagLib::FLAC::Picture *> &pictures) {
+    ifstream ifs;
+    ifs.open(path, ios::in | ios::binary);
+    if (!ifs.is_open()) return;
+
+    uint64_t position = 0;
+    unsigned char h[10];
+    if (!ReadAt(ifs, 0, h, 10)) return;
+    if (h[0] == 'I' && h[1] == 'D' && h[2] == '3') {
+        position = 10 + (uint64_t) ReadSize(h + 6, true) + ((h[5] & 0x10) ? 10 : 0);
+        if (!ReadAt(ifs, position, h, 4)) return;
+    }
+    if (h[0] != 'f' || h[1] != 'L' || h[2] != 'a' || h[3] != 'C') return;
+    position += 4;
+
+    // picture block: type, mime type, description, width, height, depth, colors, data
+    vector<RawFrame> blocks;
+    bool last = false;
+    while (!last) {
+        unsigned char b[4];
+        if (!ReadAt(ifs, position, b, 4)) break;
+        last = (b[0] & 0x80) != 0;
+        const uint64_t length = ((uint64_t) b[1] << 16) | ((uint64_t) b[2] << 8) | (uint64_t) b[3];
+        const uint64_t start = position + 4;
+        const uint64_t end = start + length;
+        position = end;
+        if ((b[0] & 0x7F) != 6) continue;
+
+        RawFrame raw = { false, { 0, 0 } };
+        bool ok = true;
+        uint64_t offset = start + 8 + ReadUint32(ifs, start + 4, &ok);
+        offset += 4 + 16 + ReadUint32(ifs, offset, &ok);
+        const uint64_t size = ReadUint32(ifs, offset, &ok);
+        offset += 4;
+        if (ok && offset + size <= end) {
+            raw.located = true;
+            raw.location.offset = offset;
+            raw.location.length = size;
+        }
+        blocks.push_back(raw);
+    }
+
+    size_t next = 0;
+    for (auto it = pictures.begin(); it != pictures.end() && next < blocks.size(); it++, next++) {
+        if (blocks[next].located && blocks[next].location.length == (*it)->data().size())
+            locations[*it] = blocks[next].location;
+    }
+}
+
+// Data atoms of covr hold type, locale and the picture. TagLib skips pictures of
+// unknown type, covers are copies sharing data of the tag - keyed by the data.
+void AttachmentSource::Locate(const string &path, const TagLib::MP4::CoverArtList &covers) {
+    ifstream ifs;
+    ifs.open(path, ios::in | ios::binary);
+    if (!ifs.is_open()) return;
+
+    MP4Atom covr;
+    if (!FindMP4Atom(ifs, "moov/udta/meta/ilst/covr", &covr)) return;
+
+    auto cover = covers.begin();
+    MP4Atom data;
+    for (uint64_t position = covr.content; cover != covers.end() && ReadMP4Atom(ifs, position, covr.end, &data); position = data.end) {
+        if (string(data.name) != "data") break;
+        bool ok = true;
+        const uint32_t type = ReadUint32(ifs, data.content, &ok);
+        if (!ok) break;
+        if (type != TagLib::MP4::CoverArt::JPEG && type != TagLib::MP4::CoverArt::PNG && type != TagLib::MP4::CoverArt::BMP
+                && type != TagLib::MP4::CoverArt::GIF && type != TagLib::MP4::CoverArt::Unknown) continue;
+        const uint64_t start = data.content + 8;
+        const TagLib::ByteVector bytes = cover->data();
+        if (!bytes.isEmpty() && start <= data.end && data.end - start == bytes.size())
+            locations[bytes.data()] = { start, data.end - start };
+        cover++;
+    }
+}
+
+const AttachmentLocation *AttachmentSource::Find(const TagLib::ID3v2::Frame *frame) const {
+    auto it = locations.find(frame);
+    return it == locations.end() ? nullptr : &it->second;
+}
+
+const AttachmentLocation *AttachmentSource::Find(const TagLib::FLAC::Picture *picture) const {
+    auto it = locations.find(picture);
+    return it == locations.end() ? nullptr : &it->second;
+}
+
+const AttachmentLocation *AttachmentSource::Find(const TagLib::MP4::CoverArt &cover) const {
+    const TagLib::ByteVector bytes = cover.data();
+    auto it = locations.find(bytes.data());
+    return it == locations.end() ? nullptr : &it->second;
+}
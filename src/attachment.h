@@ -0,0 +1,41 @@
+#ifndef TAGIO_ATTACHMENT_H
+#define TAGIO_ATTACHMENT_H
+
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/id3v2frame.h>
+#include <taglib/flacpicture.h>
+#include <taglib/mp4coverart.h>
+
+// Attachment data stored as is in the audio file.
+struct AttachmentLocation {
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Locations of APIC and GEOB data in the file the ID3v2 tag was read from
+// and of FLAC picture blocks and MP4 covers (fileExtracted AS_HANDLE). Frame (block) headers
+// are walked on disk and matched with TagLib frames (pictures) by order and
+// data size - attached data itself is not read. Frames stored compressed,
+// encrypted or unsynchronised have no location.
+class AttachmentSource {
+public:
+    AttachmentSource() {}
+
+    void Locate(const std::string &path, TagLib::ID3v2::Tag *tag);
+    void Locate(const std::string &path, const TagLib::List<TagLib::FLAC::Picture *> &pictures);
+    void Locate(const std::string &path, const TagLib::MP4::CoverArtList &covers);
+
+    // nullptr when the data has to be exported from memory
+    const AttachmentLocation *Find(const TagLib::ID3v2::Frame *frame) const;
+    const AttachmentLocation *Find(const TagLib::FLAC::Picture *picture) const;
+    const AttachmentLocation *Find(const TagLib::MP4::CoverArt &cover) const;
+
+private:
+    std::map<const void *, AttachmentLocation> locations;
+};
+
+
+#endif //TAGIO_ATTACHMENT_H
@@ -0,0 +1,48 @@
+#include "attachmentset.h"
+#include "id3v2frame.h"
+#include "flacpicture.h"
+
+#include <taglib/id3v2header.h>
+#include <taglib/id3v2framefactory.h>
+
+
+AttachmentSet::~AttachmentSet() {
+    for (auto picture : pictures) delete picture;
+}
+
+void AttachmentSet::Prepare(Configuration *conf) {
+    TagLib::ID3v2::FrameList list = staging.frameList();
+    for (auto frame : list) {
+        LoadID3v2Attachment(frame, fmap, conf);
+        frames.push_back(frame->render());
+    }
+    for (auto picture : pictures)
+        LoadFLACPicture(picture, fmap, conf);
+}
+
+void AttachmentSet::AddID3v2To(TagPatch *patch) const {
+    // rendered frames are ID3v2.4 - frames of the file are converted on save
+    TagLib::ID3v2::Header header;
+    for (auto const &data : frames) {
+        TagLib::ID3v2::Frame *frame = TagLib::ID3v2::FrameFactory::instance()->createFrame(data, &header);
+        if (frame != nullptr) patch->AddSharedID3v2(frame);
+    }
+}
+
+void AttachmentSet::AddPicturesTo(TagPatch *patch) const {
+    if (pictures.empty()) return;
+    std::vector<TagLib::FLAC::Picture *> copies;
+    for (auto picture : pictures) {
+        auto *copy = new TagLib::FLAC::Picture();
+        copy->setType(picture->type());
+        copy->setMimeType(picture->mimeType());
+        copy->setDescription(picture->description());
+        copy->setWidth(picture->width());
+        copy->setHeight(picture->height());
+        copy->setColorDepth(picture->colorDepth());
+        copy->setNumColors(picture->numColors());
+        copy->setData(picture->data());
+        copies.push_back(copy);
+    }
+    patch->SetPictures(copies);
+}
@@ -0,0 +1,44 @@
+#ifndef TAGIO_ATTACHMENT_SET_H
+#define TAGIO_ATTACHMENT_SET_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <taglib/id3v2tag.h>
+#include <taglib/flacpicture.h>
+
+#include "configuration.h"
+#include "patch.h"
+
+// Attachments shared by all files of writeMany - ID3v2 frames (APIC, GEOB ...)
+// for MP3 files and pictures for FLAC files. Attached files are read and frames
+// rendered once, every MP3 file then gets its own frames parsed from the
+// rendered data and every FLAC file pictures copied from the loaded ones. TagLib byte vectors share the attached data,
+// it is not copied per file.
+class AttachmentSet {
+public:
+    AttachmentSet() {}
+    ~AttachmentSet();
+
+    // main thread (import.cc)
+    void Import(v8::Object *object, Configuration *conf);
+
+    // worker thread, once before the files are written
+    void Prepare(Configuration *conf);
+
+    // Frames added to the patch of one MP3 file as one shared group, the file's
+    // own operations win over them.
+    void AddID3v2To(TagPatch *patch) const;
+
+    // Pictures added to the patch of one FLAC file.
+    void AddPicturesTo(TagPatch *patch) const;
+
+private:
+    TagLib::ID3v2::Tag staging;
+    std::map<uintptr_t, std::string> fmap;
+    std::vector<TagLib::ByteVector> frames;
+    std::vector<TagLib::FLAC::Picture *> pictures;
+};
+
+
+#endif //TAGIO_ATTACHMENT_SET_H
@@ -1,7 +1,7 @@
 #include "audioproperties.h"
 #include "wrapper.h"
 
-void ExportAudioProperties(TagLib::AudioProperties *audioProperties, v8::Object *object) {
+void ExportAudioProperties(TagLib::AudioProperties *audioProperties, Result *object) {
     TagLibWrapper o(object);
     o.SetInt32("length", audioProperties->length());
     o.SetInt32("bitrate", audioProperties->bitrate());
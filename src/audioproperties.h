@@ -1,10 +1,10 @@
 #ifndef TAGIO_AUDIOPROPERTIES_H
 #define TAGIO_AUDIOPROPERTIES_H
 
-#include <nan.h>
 #include <taglib/audioproperties.h>
+#include "result.h"
 
-void ExportAudioProperties(TagLib::AudioProperties *audioProperties, v8::Object *object);
+void ExportAudioProperties(TagLib::AudioProperties *audioProperties, Result *object);
 
 
 #endif //TAGIO_AUDIOPROPERTIES_H
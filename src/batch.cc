@@ -0,0 +1,332 @@
+#include "batch.h"
+#include "configuration.h"
+#include "reader.h"
+#include "result.h"
+#include "pool.h"
+#include "materialize.h"
+#include "mpeg.h"
+#include "flac.h"
+#include "patch.h"
+#include "attachmentset.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::deque;
+using std::mutex;
+using std::unique_lock;
+using std::condition_variable;
+using v8::Function;
+using v8::Local;
+using v8::Value;
+using v8::String;
+using v8::Object;
+using v8::Array;
+using Nan::AsyncProgressWorker;
+using Nan::AsyncWorker;
+using Nan::Callback;
+using Nan::HandleScope;
+using Nan::New;
+using Nan::Null;
+
+const uint32_t DEFAULT_CHUNK_SIZE = 64;
+
+typedef vector<Result> Chunk;
+
+// Reads many files with one configuration on up to concurrency threads of the pool.
+// Results are converted and files closed on the threads, finished results
+// are grouped into chunks and handed over to the main thread which
+// materializes them and passes them to the chunk callback.
+// Number of chunks waiting for the main thread is bounded so the results
+// do not pile up when JS is slower than the disk.
+class ReadManyWorker : public AsyncProgressWorker {
+public:
+    ReadManyWorker(Callback *callback, Callback *chunkCallback, vector<string> *paths,
+                   Configuration *conf, uint32_t chunkSize, uint32_t concurrency, int priority)
+            : AsyncProgressWorker(callback),
+              chunkCallback(chunkCallback),
+              paths(paths),
+              conf(conf),
+              chunkSize(chunkSize),
+              concurrency(concurrency),
+              priority(priority),
+              maxPending(concurrency * 2) {}
+
+    ~ReadManyWorker() {
+        delete chunkCallback;
+        delete paths;
+        delete conf;
+    }
+
+    void Execute(const ExecutionProgress &progress) {
+        PoolParallel(concurrency, priority, [this, &progress] { Run(&progress); });
+        // what is left is published when all files are read
+        unique_lock<mutex> guard(lock);
+        if (!current.empty()) {
+            pending.push_back(Chunk());
+            pending.back().swap(current);
+            progress.Send("", 0);
+        }
+    }
+
+    void HandleProgressCallback(const char *data, size_t size) {
+        Flush();
+    }
+
+    void HandleOKCallback() {
+        Flush();
+        HandleScope scope;
+        Local<Value> argv[] = { Null(), New<v8::Uint32>((uint32_t) paths->size()) };
+        callback->Call(2, argv);
+    }
+
+private:
+    Callback *chunkCallback;
+    vector<string> *paths;
+    Configuration *conf;
+    uint32_t chunkSize;
+    uint32_t concurrency;
+    int priority;
+    size_t maxPending;
+
+    std::atomic<size_t> next{0};
+    mutex lock;
+    condition_variable drained;
+    Chunk current;
+    deque<Chunk> pending;
+
+    void Run(const ExecutionProgress *progress) {
+        for (size_t i = next++; i < paths->size(); i = next++) {
+            Reader *reader = NewReader((*paths)[i], conf);
+            Result result = Result::Object();
+            Timings timings;
+            {
+                TimingsScope scope(&timings, conf->TimingsReadable());
+                reader->Read(&result);
+            }
+            delete reader;
+            // materialization of chunks is not measured per file
+            if (timings.Enabled()) {
+                timings.Export(result.SetObject("timings"));
+                timings.Record();
+            }
+            Push(std::move(result), progress);
+        }
+    }
+
+    void Push(Result &&result, const ExecutionProgress *progress) {
+        unique_lock<mutex> guard(lock);
+        current.push_back(std::move(result));
+        if (current.size() < chunkSize) return;
+        drained.wait(guard, [this] { return pending.size() < maxPending; });
+        pending.push_back(Chunk());
+        pending.back().swap(current);
+        progress->Send("", 0);
+    }
+
+    void Flush() {
+        deque<Chunk> chunks;
+        {
+            unique_lock<mutex> guard(lock);
+            chunks.swap(pending);
+        }
+        drained.notify_all();
+
+        for (auto &chunk : chunks) {
+            HandleScope scope;
+            Local<Array> results = New<Array>(chunk.size());
+            for (uint32_t i = 0; i < chunk.size(); i++)
+                results->Set(i, chunk[i].Materialize());
+            Local<Value> argv[] = { results };
+            chunkCallback->Call(1, argv);
+        }
+    }
+};
+
+// File of writeMany - its own changes (patch operations) and the response.
+struct FileWrite {
+    string path;
+    TagPatch *patch;
+    Result result;
+};
+
+// Writes many files (e.g. an album) with one configuration on up to concurrency
+// threads of the pool.
+// Attachments shared by all files are prepared once before the threads start,
+// each file gets the shared frames and its own changes applied as a patch, so
+// unchanged files are not saved. Responses are materialized at the end in order
+// of the files.
+class WriteManyWorker : public AsyncWorker {
+public:
+    WriteManyWorker(Callback *callback, vector<FileWrite> *files, AttachmentSet *shared,
+                    Configuration *conf, uint32_t concurrency, int priority, bool verify)
+            : AsyncWorker(callback),
+              files(files),
+              shared(shared),
+              conf(conf),
+              concurrency(concurrency),
+              priority(priority),
+              verify(verify) {}
+
+    ~WriteManyWorker() {
+        for (auto &file : *files) delete file.patch;
+        delete files;
+        delete shared;
+        delete conf;
+    }
+
+    void Execute() {
+        shared->Prepare(conf);
+        PoolParallel(concurrency, priority, [this] { Run(); });
+    }
+
+    void HandleOKCallback() {
+        HandleScope scope;
+        Local<Array> results = New<Array>(files->size());
+        for (uint32_t i = 0; i < files->size(); i++)
+            results->Set(i, (*files)[i].result.Materialize());
+        Local<Value> argv[] = { Null(), results };
+        callback->Call(2, argv);
+    }
+
+private:
+    vector<FileWrite> *files;
+    AttachmentSet *shared;
+    Configuration *conf;
+    uint32_t concurrency;
+    int priority;
+    bool verify;
+
+    std::atomic<size_t> next{0};
+
+    void Run() {
+        for (size_t i = next++; i < files->size(); i = next++) {
+            FileWrite &file = (*files)[i];
+            Timings timings;
+            {
+                TimingsScope scope(&timings, conf->TimingsReadable());
+                const string ext = FileExtension(file.path);
+                if (ext == ".mp3") {
+                    shared->AddID3v2To(file.patch);
+                    PatchMPEGFile(file.path, conf, file.patch, verify, &file.result);
+                } else if (ext == ".flac") {
+                    shared->AddPicturesTo(file.patch);
+                    PatchFLACFile(file.path, conf, file.patch, verify, &file.result);
+                } else {
+                    file.result.SetString("path", file.path);
+                    file.result.SetString("error", "Unsupported file");
+                }
+            }
+            // frames and pictures not moved to the file are released on the thread
+            delete file.patch;
+            file.patch = nullptr;
+            if (timings.Enabled()) {
+                timings.Export(file.result.SetObject("timings"));
+                timings.Record();
+            }
+        }
+    }
+};
+
+
+NAN_METHOD(ReadMany) {
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *chunkCallback = new Callback(info[1].As<Function>());
+    Callback *callback = new Callback(info[2].As<Function>());
+
+    Local<String> pathsKey = New<String>("paths").ToLocalChecked();
+    Local<String> confKey = New<String>("configuration").ToLocalChecked();
+    Local<String> chunkSizeKey = New<String>("chunkSize").ToLocalChecked();
+    Local<String> concurrencyKey = New<String>("concurrency").ToLocalChecked();
+    Local<String> fieldsKey = New<String>("fields").ToLocalChecked();
+
+    Local<Array> pathsVal = reqObj->Get(pathsKey).As<Array>();
+    vector<string> *paths = new vector<string>();
+    paths->reserve(pathsVal->Length());
+    for (uint32_t i = 0; i < pathsVal->Length(); i++) {
+        String::Utf8Value pathVal(pathsVal->Get(i));
+        paths->push_back(string(*pathVal));
+    }
+
+    Local<Object> confVal = reqObj->Get(confKey).As<Object>();
+    Configuration *conf = new Configuration();
+    ImportConfiguration(*confVal, conf);
+
+    if (reqObj->Has(fieldsKey)) {
+        Local<Array> fieldsVal = reqObj->Get(fieldsKey).As<Array>();
+        ImportProjection(*fieldsVal, &conf->Fields());
+    }
+
+    uint32_t chunkSize = DEFAULT_CHUNK_SIZE;
+    if (reqObj->Has(chunkSizeKey)) chunkSize = reqObj->Get(chunkSizeKey)->Uint32Value();
+    if (chunkSize == 0) chunkSize = DEFAULT_CHUNK_SIZE;
+
+    uint32_t concurrency = 0;
+    if (reqObj->Has(concurrencyKey)) concurrency = reqObj->Get(concurrencyKey)->Uint32Value();
+    if (concurrency == 0) concurrency = std::thread::hardware_concurrency();
+    if (concurrency == 0) concurrency = 4;
+
+    int priority = RequestPriority(*reqObj);
+    PoolQueueWorker(new ReadManyWorker(callback, chunkCallback, paths, conf, chunkSize, concurrency, priority), priority);
+}
+
+NAN_METHOD(WriteMany) {
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> filesKey = New<String>("files").ToLocalChecked();
+    Local<String> sharedKey = New<String>("shared").ToLocalChecked();
+    Local<String> confKey = New<String>("configuration").ToLocalChecked();
+    Local<String> concurrencyKey = New<String>("concurrency").ToLocalChecked();
+    Local<String> verifyKey = New<String>("verify").ToLocalChecked();
+    Local<String> pathKey = New<String>("path").ToLocalChecked();
+    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
+    Local<String> xiphCommentKey = New<String>("xiphComment").ToLocalChecked();
+
+    Configuration *conf = new Configuration();
+    if (reqObj->Has(confKey)) {
+        Local<Object> confVal = reqObj->Get(confKey).As<Object>();
+        ImportConfiguration(*confVal, conf);
+    }
+
+    AttachmentSet *shared = new AttachmentSet();
+    if (reqObj->Has(sharedKey)) {
+        Local<Object> sharedVal = reqObj->Get(sharedKey).As<Object>();
+        shared->Import(*sharedVal, conf);
+    }
+
+    Local<Array> filesVal = reqObj->Get(filesKey).As<Array>();
+    vector<FileWrite> *files = new vector<FileWrite>();
+    files->reserve(filesVal->Length());
+    for (uint32_t i = 0; i < filesVal->Length(); i++) {
+        Local<Object> fileVal = filesVal->Get(i).As<Object>();
+        String::Utf8Value pathVal(fileVal->Get(pathKey));
+        TagPatch *patch = new TagPatch();
+        if (conf->ID3v2Writable() && fileVal->Has(id3v2Key)) {
+            Local<Array> id3v2Val = fileVal->Get(id3v2Key).As<Array>();
+            patch->ImportID3v2(*id3v2Val, conf);
+        }
+        if (conf->XIPHCommentWritable() && fileVal->Has(xiphCommentKey)) {
+            Local<Array> xiphCommentVal = fileVal->Get(xiphCommentKey).As<Array>();
+            patch->ImportXiphComment(*xiphCommentVal);
+        }
+        files->push_back({ string(*pathVal), patch, Result::Object() });
+    }
+
+    uint32_t concurrency = 0;
+    if (reqObj->Has(concurrencyKey)) concurrency = reqObj->Get(concurrencyKey)->Uint32Value();
+    if (concurrency == 0) concurrency = std::thread::hardware_concurrency();
+    if (concurrency == 0) concurrency = 4;
+
+    bool verify = reqObj->Has(verifyKey) && reqObj->Get(verifyKey)->BooleanValue();
+
+    int priority = RequestPriority(*reqObj);
+    PoolQueueWorker(new WriteManyWorker(callback, files, shared, conf, concurrency, priority, verify), priority);
+}
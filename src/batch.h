@@ -0,0 +1,9 @@
+#ifndef TAGIO_BATCH_H
+#define TAGIO_BATCH_H
+
+#include <nan.h>
+
+NAN_METHOD(ReadMany);
+NAN_METHOD(WriteMany);
+
+#endif //TAGIO_BATCH_H
@@ -1,26 +1,54 @@
 #include "bytevector.h"
+#include "timings.h"
 
 #include "md5.h"
+#include "xxh3.h"
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <sys/stat.h>
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+#include <direct.h>
+#include <process.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-static string CountMD5(TagLib::ByteVector byteVector) {
-    string s = string(byteVector.data(), byteVector.size());
-    string hash = md5(s);
-    return hash;
+typedef string (*HashFunction)(const char *data, size_t length);
+
+static HashFunction HashEngine(int method) {
+    switch (method) {
+        case FILE_HASH_MD5:
+            return md5;
+        default:
+            return xxh3;
+    }
 }
 
-static string NewFileName(TagLib::ByteVector byteVector, string mimeType) {
-    string hash = CountMD5(byteVector);
+// Hashes data in place - const data() does not detach shared byte vector.
+static string CountHash(const TagLib::ByteVector &byteVector, int method) {
+    PhaseTimer timer(PHASE_HASH, byteVector.size());
+    return HashEngine(method)(byteVector.data(), byteVector.size());
+}
+
+static string NewFileName(const TagLib::ByteVector &byteVector, string mimeType, int method) {
+    string hash = CountHash(byteVector, method);
     string ext = (mimeType.empty()) ? "bin" : mimeType.substr(mimeType.find("/") + 1);
     //TODO: Implement complete mime type table...
-    if (mimeType.compare("image/jpeg")) ext = "jpg";
-    else if (mimeType.compare("image/pjpeg")) ext = "jpg";
-    else if (mimeType.compare("image/png")) ext = "png";
-    else if (mimeType.compare("text/plain")) ext = "txt";
+    if (mimeType.compare("image/jpeg") == 0) ext = "jpg";
+    else if (mimeType.compare("image/pjpeg") == 0) ext = "jpg";
+    else if (mimeType.compare("image/png") == 0) ext = "png";
+    else if (mimeType.compare("text/plain") == 0) ext = "txt";
     return hash + '.' + ext;
 }
 
@@ -44,40 +72,190 @@ static string NewPath(string directoryPath, string fileName) {
 #endif
 }
 
-//static inline bool FileExist(const std::string &name) {
-//    struct stat buffer;
-//    return (stat (name.c_str(), &buffer) == 0);
-//}
+static inline bool FileExist(const std::string &name) {
+    struct stat buffer;
+    return (stat (name.c_str(), &buffer) == 0);
+}
 
-TagLib::String ExportByteVector(TagLib::ByteVector byteVector, TagLib::String mimeType, Configuration *conf) {
-    if (conf->FileExtracted() == FILE_EXTRACTED_IS_IGNORED) return TagLib::String("IGNORED");
-    string directory = conf->FileDirectory().to8Bit(true);
-    //std::cout << directory << std::endl;
-    string fileName = NewFileName(byteVector, mimeType.to8Bit(true));
-    string filePath = NewPath(directory, fileName);
+static inline void MakeDirectory(const std::string &name) {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+    _mkdir(name.c_str());
+#else
+    mkdir(name.c_str(), 0777);
+#endif
+}
+
+// Unique per process, thread and call - concurrent writers never share temporary file.
+string TemporaryPath(const string &filePath) {
+    static atomic<unsigned long> counter(0);
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+    unsigned long pid = (unsigned long) _getpid();
+#else
+    unsigned long pid = (unsigned long) getpid();
+#endif
+    size_t tid = hash<thread::id>()(this_thread::get_id());
+    return filePath + '.' + to_string(pid) + '.' + to_string(tid) + '.' + to_string(counter++) + ".tmp";
+}
 
+// Attachments are stored by content - file name is hash of data and the file is
+// written only when missing. Files are sharded to subdirectories by first two
+// characters of the hash. Data goes to temporary file first and is renamed to
+// final name, so readers never see partially written file. Empty path is returned
+// when the file could not be written.
+static string StoreByteVector(const TagLib::ByteVector &byteVector, const string &directory, const string &fileName) {
+    string shardPath = NewPath(directory, fileName.substr(0, 2));
+    string filePath = NewPath(shardPath, fileName);
+    if (FileExist(filePath)) return filePath;
+
+    PhaseTimer timer(PHASE_STORE, byteVector.size());
+    MakeDirectory(shardPath);
+    string tempPath = TemporaryPath(filePath);
     ofstream ofs;
-    ofs.open(filePath, ios::out | ios::binary);
+    ofs.open(tempPath, ios::out | ios::binary);
     ofs.write(byteVector.data(), byteVector.size());
     ofs.close();
+    if (ofs.fail() || rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        remove(tempPath.c_str());
+        // other worker may have won the race (rename does not replace on Windows)
+        if (!FileExist(filePath)) return string();
+    }
+    return filePath;
+}
+
+TagLib::String ExportByteVector(TagLib::ByteVector byteVector, TagLib::String mimeType, Configuration *conf) {
+    if (conf->FileExtracted() == FILE_EXTRACTED_IS_IGNORED) return TagLib::String("IGNORED");
+    string directory = conf->FileDirectory().to8Bit(true);
+    string fileName = NewFileName(byteVector, mimeType.to8Bit(true), conf->FileHash());
+    string filePath = StoreByteVector(byteVector, directory, fileName);
 
     TagLib::String pathString(filePath);
     return pathString;
 }
 
+// Handle describes where the data is in the audio file, lib/attachment.js reads it on demand.
+// Data which is not stored as is in the file is carried in the handle.
+static void ExportHandle(Result *handle, const TagLib::ByteVector &byteVector, const TagLib::String &mimeType,
+                         const AttachmentLocation *location) {
+    handle->SetNumber("size", byteVector.size());
+    handle->SetString("mimeType", mimeType.to8Bit(true));
+    if (location != nullptr) {
+        handle->SetNumber("offset", (double) location->offset);
+        handle->SetNumber("length", (double) location->length);
+    } else {
+        handle->SetBuffer("data", byteVector);
+    }
+}
+
+void ExportByteVector(TagLibWrapper &o, const char *key, TagLib::ByteVector byteVector, TagLib::String mimeType, Configuration *conf,
+                      const AttachmentLocation *location) {
+    if (conf->FileExtracted() == FILE_EXTRACTED_AS_BUFFER) o.SetBuffer(key, byteVector);
+    else if (conf->FileExtracted() == FILE_EXTRACTED_AS_HANDLE) ExportHandle(o.SetObject(key), byteVector, mimeType, location);
+    else o.SetString(key, ExportByteVector(byteVector, mimeType, conf));
+}
+
 TagLib::ByteVector ImportByteVector(TagLib::String pathString, Configuration *conf) {
     return ImportByteVector(pathString.to8Bit(true), conf);
 }
 
 
-TagLib::ByteVector ImportByteVector(std::string path, Configuration *conf) {
+// Imported files are cached by path and validated by size and modification time
+// (in nanoseconds where the platform has them), so the same cover written to
+// every track of an album is loaded only once. Cached byte vectors are
+// implicitly shared, frames get them without copying. Capacity is importCacheSize
+// of the request's configuration, 0 bypasses the cache.
+struct ImportCacheEntry {
+    string path;
+    off_t size;
+    int64_t mtime;
+    TagLib::ByteVector data;
+};
+
+static mutex importCacheLock;
+static list<ImportCacheEntry> importCache; // most recently used first
+static size_t importCacheSize = 0;
+
+static int64_t ModificationTime(const struct stat &st) {
+#if defined(__APPLE__)
+    return (int64_t) st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#elif defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+    return (int64_t) st.st_mtime * 1000000000LL;
+#else
+    return (int64_t) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+static bool FindImported(const string &path, const struct stat &st, TagLib::ByteVector &data) {
+    lock_guard<mutex> guard(importCacheLock);
+    for (auto it = importCache.begin(); it != importCache.end(); ++it) {
+        if (it->path != path) continue;
+        if (it->size == st.st_size && it->mtime == ModificationTime(st)) {
+            data = it->data;
+            importCache.splice(importCache.begin(), importCache, it);
+            return true;
+        }
+        importCacheSize -= it->data.size();
+        importCache.erase(it);
+        return false;
+    }
+    return false;
+}
+
+// Entry of the path loaded meanwhile by another thread is replaced.
+static void AddImported(const string &path, const struct stat &st, const TagLib::ByteVector &data, size_t capacity) {
+    if (data.size() > capacity / 4) return;
+    lock_guard<mutex> guard(importCacheLock);
+    for (auto it = importCache.begin(); it != importCache.end(); ++it) {
+        if (it->path != path) continue;
+        importCacheSize -= it->data.size();
+        importCache.erase(it);
+        break;
+    }
+    importCache.push_front(ImportCacheEntry { path, st.st_size, ModificationTime(st), data });
+    importCacheSize += data.size();
+    while (importCacheSize > capacity) {
+        importCacheSize -= importCache.back().data.size();
+        importCache.pop_back();
+    }
+}
+
+// Reads whole file straight into byte vector, shorter when the file was truncated meanwhile.
+static TagLib::ByteVector ReadFile(const string &path, size_t length) {
+    if (length == 0) return TagLib::ByteVector();
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+    TagLib::ByteVector data((TagLib::uint) length, 0);
     ifstream ifs;
     ifs.open(path, ios::in | ios::binary);
-    ifs.seekg(0, ios::end);
-    long length = ifs.tellg();
-    char *data = new char[length];
-    ifs.seekg(0, ios::beg);
-    ifs.read(data, length);
+    ifs.read(data.data(), length);
+    if (!ifs) data.resize((TagLib::uint) ifs.gcount());
     ifs.close();
-    return TagLib::ByteVector(data, (TagLib::uint) length);
-}
\ No newline at end of file
+    return data;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return TagLib::ByteVector();
+    TagLib::ByteVector data((TagLib::uint) length, 0);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, data.data() + done, length - done, (off_t) done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t) n;
+    }
+    close(fd);
+    if (done < length) data.resize((TagLib::uint) done);
+    return data;
+#endif
+}
+
+TagLib::ByteVector ImportByteVector(std::string path, Configuration *conf) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return TagLib::ByteVector();
+
+    const size_t capacity = conf->ImportCacheSize();
+    TagLib::ByteVector data;
+    if (capacity > 0 && FindImported(path, st, data)) return data;
+
+    data = ReadFile(path, (size_t) st.st_size);
+    // truncated meanwhile - not cached under the size of stat
+    if (capacity > 0 && data.size() == (size_t) st.st_size) AddImported(path, st, data, capacity);
+    return data;
+}
@@ -4,9 +4,16 @@
 #include <taglib/tstring.h>
 #include <taglib/tbytevector.h>
 #include "configuration.h"
+#include "wrapper.h"
+#include "attachment.h"
 
 TagLib::String ExportByteVector(TagLib::ByteVector byteVector, TagLib::String mimeType, Configuration *conf);
+void ExportByteVector(TagLibWrapper &o, const char *key, TagLib::ByteVector byteVector, TagLib::String mimeType, Configuration *conf,
+                      const AttachmentLocation *location = nullptr);
 TagLib::ByteVector ImportByteVector(TagLib::String path, Configuration *conf);
 TagLib::ByteVector ImportByteVector(std::string path, Configuration *conf);
 
+// Temporary file next to the file - renamed over it when complete.
+std::string TemporaryPath(const std::string &filePath);
+
 #endif //TAGIO_FILESYSTEM_H
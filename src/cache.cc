@@ -0,0 +1,290 @@
+#include "cache.h"
+#include "xxh3.h"
+
+#include <cstring>
+#include <map>
+#include <sys/stat.h>
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__))
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+using std::map;
+using std::mutex;
+using std::unique_lock;
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+
+// no stable inode numbers - cache is not available
+
+MetadataCache *MetadataCache::Get(Configuration *conf) { return nullptr; }
+bool MetadataCache::MakeKey(const string &path, Configuration *conf, CacheKey *key) { return false; }
+bool MetadataCache::Lookup(const CacheKey &key, Result *content) { return false; }
+void MetadataCache::Store(const CacheKey &key, const Result &content) {}
+void MetadataCache::Invalidate(const string &path) {}
+
+#else
+
+static const char CACHE_MAGIC[8] = { 'T', 'A', 'G', 'I', 'O', 'C', 'C', 0 };
+const uint32_t CACHE_VERSION = 2;
+const uint32_t CACHE_SLOTS = 1 << 18;                  // ~190k files at 75% load
+const uint64_t CACHE_MAX_DATA = 1024ULL * 1024 * 1024;  // 1GB of serialized results
+
+const uint32_t SLOT_EMPTY = 0;
+const uint32_t SLOT_USED = 1;
+const uint32_t SLOT_DELETED = 2;
+
+struct MetadataCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint32_t used;      // used and deleted slots - probing stops on empty one
+    uint32_t reserved;
+    uint64_t dataSize;
+};
+
+struct MetadataCache::Slot {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t conf;
+    uint64_t offset;
+    uint64_t checksum;
+    uint32_t length;
+    uint32_t state;
+};
+
+static size_t IndexSize() {
+    return sizeof(MetadataCache::Header) + (size_t) CACHE_SLOTS * sizeof(MetadataCache::Slot);
+}
+
+static uint32_t SlotIndex(uint64_t dev, uint64_t ino) {
+    uint64_t h = (ino ^ (dev << 32 | dev >> 32)) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t) (h >> 32) & (CACHE_SLOTS - 1);
+}
+
+MetadataCache *MetadataCache::Get(Configuration *conf) {
+    // never freed - caches are shared by all requests until the process exits
+    static mutex *cachesLock = new mutex();
+    static map<string, MetadataCache *> *caches = new map<string, MetadataCache *>();
+
+    string directory = conf->CacheDirectory().to8Bit(true);
+    if (directory.empty()) return nullptr;
+    // attachment content would bloat the cache
+    if (conf->FileExtracted() == FILE_EXTRACTED_AS_BUFFER) return nullptr;
+
+    unique_lock<mutex> guard(*cachesLock);
+    auto it = caches->find(directory);
+    if (it != caches->end()) return it->second;
+    MetadataCache *cache = new MetadataCache();
+    if (!cache->Open(directory)) {
+        delete cache;
+        cache = nullptr; // remembered, directory is not tried again
+    }
+    (*caches)[directory] = cache;
+    return cache;
+}
+
+static void AppendNumber(string &bytes, int64_t value) {
+    bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void AppendString(string &bytes, const TagLib::String &value) {
+    bytes += value.to8Bit(true);
+    bytes += '\0';
+}
+
+// Options changing the exported content of a file - writing, pool, timings and the
+// configuration echoed back by the request do not split the entries.
+static string ContentOptions(Configuration *conf) {
+    string bytes;
+    const bool readable[] = {
+        conf->AudioPropertiesReadable(), conf->TagReadable(), conf->APEReadable(), conf->ID3v1Readable(),
+        conf->ID3v2Readable(), conf->XIPHCommentReadable(), conf->MP4Readable()
+    };
+    for (bool b : readable) bytes += b ? '1' : '0';
+    AppendNumber(bytes, conf->AudioPropertiesStyle());
+    AppendNumber(bytes, conf->FileExtracted());
+    AppendString(bytes, conf->FileDirectory());
+    AppendNumber(bytes, conf->FileHash());
+    AppendString(bytes, conf->FileUrlPrefix());
+    AppendNumber(bytes, conf->ID3v1Encoding());
+    AppendNumber(bytes, conf->ID3v2Encoding());
+    bytes += conf->Fields().Canonical();
+    return bytes;
+}
+
+bool MetadataCache::MakeKey(const string &path, Configuration *conf, CacheKey *key) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    key->dev = (uint64_t) st.st_dev;
+    key->ino = (uint64_t) st.st_ino;
+    key->size = (uint64_t) st.st_size;
+#if defined(__APPLE__)
+    key->mtime = (int64_t) st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    key->mtime = (int64_t) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    string bytes = ContentOptions(conf);
+    key->conf = XXH3_64bits(bytes.data(), bytes.size());
+    return true;
+}
+
+bool MetadataCache::Open(const string &directory) {
+    string indexPath = directory + "/tagio-cache.idx";
+    string dataPath = directory + "/tagio-cache.dat";
+
+    indexFd = open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (indexFd < 0) return false;
+    // one process per directory, others run without the cache
+    if (flock(indexFd, LOCK_EX | LOCK_NB) != 0) {
+        close(indexFd);
+        return false;
+    }
+    dataFd = open(dataPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (dataFd < 0) {
+        close(indexFd);
+        return false;
+    }
+
+    struct stat indexStat, dataStat;
+    bool fresh = fstat(indexFd, &indexStat) != 0 || (size_t) indexStat.st_size != IndexSize();
+    if (fresh && (ftruncate(indexFd, 0) != 0 || ftruncate(indexFd, (off_t) IndexSize()) != 0)) {
+        close(indexFd);
+        close(dataFd);
+        return false;
+    }
+    void *map = mmap(nullptr, IndexSize(), PROT_READ | PROT_WRITE, MAP_SHARED, indexFd, 0);
+    if (map == MAP_FAILED) {
+        close(indexFd);
+        close(dataFd);
+        return false;
+    }
+    header = static_cast<Header *>(map);
+    slots = reinterpret_cast<Slot *>(header + 1);
+
+    if (fresh ||
+        memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header->version != CACHE_VERSION ||
+        header->slots != CACHE_SLOTS ||
+        fstat(dataFd, &dataStat) != 0 ||
+        (uint64_t) dataStat.st_size < header->dataSize)
+        Reset();
+    return true;
+}
+
+// Truncating the index zeroes it without touching every page.
+void MetadataCache::Reset() {
+    if (ftruncate(indexFd, 0) != 0 || ftruncate(indexFd, (off_t) IndexSize()) != 0)
+        memset(slots, 0, (size_t) CACHE_SLOTS * sizeof(Slot));
+    memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header->version = CACHE_VERSION;
+    header->slots = CACHE_SLOTS;
+    header->used = 0;
+    header->dataSize = 0;
+    if (ftruncate(dataFd, 0) != 0)
+        header->dataSize = (uint64_t) lseek(dataFd, 0, SEEK_END); // keep appending after old records
+}
+
+MetadataCache::Slot *MetadataCache::Find(uint64_t dev, uint64_t ino, uint64_t conf) {
+    uint32_t index = SlotIndex(dev, ino);
+    for (uint32_t n = 0; n < CACHE_SLOTS; n++) {
+        Slot *slot = &slots[(index + n) & (CACHE_SLOTS - 1)];
+        if (slot->state == SLOT_EMPTY) return nullptr;
+        if (slot->state == SLOT_USED && slot->dev == dev && slot->ino == ino && slot->conf == conf)
+            return slot;
+    }
+    return nullptr;
+}
+
+bool MetadataCache::Lookup(const CacheKey &key, Result *content) {
+    Slot slot;
+    {
+        unique_lock<mutex> guard(lock);
+        Slot *found = Find(key.dev, key.ino, key.conf);
+        if (found == nullptr) return false;
+        slot = *found;
+    }
+    if (slot.size != key.size || slot.mtime != key.mtime) return false;
+
+    string record(slot.length, '\0');
+    if (pread(dataFd, &record[0], slot.length, (off_t) slot.offset) != (ssize_t) slot.length) return false;
+    if (XXH3_64bits(record.data(), record.size()) != slot.checksum) return false;
+
+    Result cached;
+    const char *data = record.data();
+    const char *end = data + record.size();
+    if (!cached.Deserialize(data, end) || data != end || cached.GetType() != Result::OBJECT) return false;
+    *content = std::move(cached);
+    return true;
+}
+
+void MetadataCache::Store(const CacheKey &key, const Result &content) {
+    string record;
+    content.Serialize(record);
+
+    unique_lock<mutex> guard(lock);
+    if (header->used + 1 > CACHE_SLOTS / 4 * 3 || header->dataSize + record.size() > CACHE_MAX_DATA)
+        Reset();
+
+    uint64_t offset = header->dataSize;
+    if (pwrite(dataFd, record.data(), record.size(), (off_t) offset) != (ssize_t) record.size()) return;
+    header->dataSize += record.size();
+
+    // replace entry of the same file and configuration, else take first free slot
+    uint32_t index = SlotIndex(key.dev, key.ino);
+    Slot *target = nullptr;
+    for (uint32_t n = 0; n < CACHE_SLOTS; n++) {
+        Slot *slot = &slots[(index + n) & (CACHE_SLOTS - 1)];
+        if (slot->state == SLOT_USED && slot->dev == key.dev && slot->ino == key.ino && slot->conf == key.conf) {
+            target = slot;
+            break;
+        }
+        if (slot->state == SLOT_DELETED && target == nullptr) target = slot;
+        if (slot->state == SLOT_EMPTY) {
+            if (target == nullptr) {
+                target = slot;
+                header->used++;
+            }
+            break;
+        }
+    }
+    if (target == nullptr) return;
+
+    target->dev = key.dev;
+    target->ino = key.ino;
+    target->size = key.size;
+    target->mtime = key.mtime;
+    target->conf = key.conf;
+    target->offset = offset;
+    target->length = (uint32_t) record.size();
+    target->checksum = XXH3_64bits(record.data(), record.size());
+    target->state = SLOT_USED;
+}
+
+void MetadataCache::Invalidate(const string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return;
+    uint64_t dev = (uint64_t) st.st_dev;
+    uint64_t ino = (uint64_t) st.st_ino;
+
+    unique_lock<mutex> guard(lock);
+    uint32_t index = SlotIndex(dev, ino);
+    for (uint32_t n = 0; n < CACHE_SLOTS; n++) {
+        Slot *slot = &slots[(index + n) & (CACHE_SLOTS - 1)];
+        if (slot->state == SLOT_EMPTY) return;
+        if (slot->state == SLOT_USED && slot->dev == dev && slot->ino == ino)
+            slot->state = SLOT_DELETED;
+    }
+}
+
+#endif
+
+void InvalidateMetadataCache(const string &path, Configuration *conf) {
+    MetadataCache *cache = MetadataCache::Get(conf);
+    if (cache != nullptr) cache->Invalidate(path);
+}
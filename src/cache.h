@@ -0,0 +1,66 @@
+#ifndef TAGIO_CACHE_H
+#define TAGIO_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+#include "configuration.h"
+#include "result.h"
+
+// Identity of a file content as seen by stat and of the configuration used to read it.
+struct CacheKey {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;  // nanoseconds
+    uint64_t conf;  // hash of the options changing the content and projection
+};
+
+// Persistent cache of read results stored in configuration's cacheDirectory.
+//
+// Index is a memory mapped open addressing table of (device, inode) slots,
+// size, mtime and configuration hash validate the entry. Results are
+// serialized to an append only data file. Unchanged file costs one stat,
+// one probe of the index and one read of the record.
+// When the index or the data file grows over its limit the cache is reset.
+//
+// Directory is locked by the first process using it, other processes
+// work without the cache. Not available on Windows.
+class MetadataCache {
+public:
+    // Cache for the configuration, nullptr when caching is disabled or unavailable.
+    static MetadataCache *Get(Configuration *conf);
+
+    // Stat the file - false when the file can not be cached.
+    static bool MakeKey(const std::string &path, Configuration *conf, CacheKey *key);
+
+    bool Lookup(const CacheKey &key, Result *content);
+    void Store(const CacheKey &key, const Result &content);
+
+    // Drop entries of the file for all configurations.
+    void Invalidate(const std::string &path);
+
+    // on-disk layout of the index
+    struct Header;
+    struct Slot;
+
+private:
+    MetadataCache() {}
+    bool Open(const std::string &directory);
+    void Reset();
+
+    Slot *Find(uint64_t dev, uint64_t ino, uint64_t conf);
+
+    std::mutex lock;
+    int indexFd = -1;
+    int dataFd = -1;
+    Header *header = nullptr;
+    Slot *slots = nullptr;
+};
+
+// Called after the file is written, no-op when caching is disabled.
+void InvalidateMetadataCache(const std::string &path, Configuration *conf);
+
+
+#endif //TAGIO_CACHE_H
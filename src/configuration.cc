@@ -3,20 +3,6 @@
 
 using namespace std;
 
-static int FileExtractedAsCode(TagLib::String string) {
-    std::string s = string.to8Bit(true);
-    if (s.compare("IS_IGNORED") == 0)
-        return FILE_EXTRACTED_IS_IGNORED;
-    else if (s.compare("AS_FILENAME") == 0)
-        return FILE_EXTRACTED_AS_FILENAME;
-    else if (s.compare("AS_ABSOLUTE_URL") == 0)
-        return FILE_EXTRACTED_AS_ABSOLUTE_URL;
-    else if (s.compare("AS_RELATIVE_URL") == 0)
-        return FILE_EXTRACTED_AS_RELATIVE_URL;
-    else
-        return FILE_EXTRACTED_IS_IGNORED;
-}
-
 static TagLib::String FileExtractedAsString(int method) {
     switch(method) {
         case FILE_EXTRACTED_IS_IGNORED:
@@ -27,19 +13,48 @@ static TagLib::String FileExtractedAsString(int method) {
             return "AS_ABSOLUTE_URL";
         case FILE_EXTRACTED_AS_RELATIVE_URL:
             return "AS_RELATIVE_URL";
+        case FILE_EXTRACTED_AS_BUFFER:
+            return "AS_BUFFER";
+        case FILE_EXTRACTED_AS_HANDLE:
+            return "AS_HANDLE";
         default:
             return "IS_IGNORED";
     }
 }
 
-void ExportConfiguration(Configuration *conf, v8::Object *object) {
+static TagLib::String FileHashAsString(int method) {
+    switch(method) {
+        case FILE_HASH_MD5:
+            return "MD5";
+        default:
+            return "XXH3";
+    }
+}
+
+static TagLib::String AudioPropertiesStyleAsString(int style) {
+    switch(style) {
+        case AUDIO_PROPERTIES_FAST:
+            return "FAST";
+        case AUDIO_PROPERTIES_ACCURATE:
+            return "ACCURATE";
+        default:
+            return "AVERAGE";
+    }
+}
+
+void ExportConfiguration(Configuration *conf, Result *object) {
     TagLibWrapper o(object);
     o.SetString("fileExtracted", FileExtractedAsString(conf->FileExtracted()));
     o.SetString("fileDirectory", conf->FileDirectory());
+    o.SetString("fileHash", FileHashAsString(conf->FileHash()));
     o.SetString("fileUrlPrefix", conf->FileUrlPrefix());
+    o.SetString("cacheDirectory", conf->CacheDirectory());
+    o.SetUint32("importCacheSize", conf->ImportCacheSize());
     o.SetBoolean("configurationReadable", conf->ConfigurationReadable());
     o.SetBoolean("audioPropertiesReadable", conf->AudioPropertiesReadable());
+    o.SetString("audioPropertiesStyle", AudioPropertiesStyleAsString(conf->AudioPropertiesStyle()));
     o.SetBoolean("tagReadable", conf->TagReadable());
+    o.SetBoolean("timingsReadable", conf->TimingsReadable());
     o.SetBoolean("apeReadable", conf->APEReadable());
     o.SetBoolean("apeWritable", conf->APEWritable());
     o.SetBoolean("id3v1Readable", conf->ID3v1Readable());
@@ -50,28 +65,13 @@ void ExportConfiguration(Configuration *conf, v8::Object *object) {
     o.SetUint32("id3v2Version", conf->ID3v2Version());
     o.SetEncoding("id3v2Encoding", conf->ID3v2Encoding());
     o.SetBoolean("id3v2UseFrameEncoding", conf->ID3v2UseFrameEncoding());
+    o.SetUint32("id3v2Padding", conf->ID3v2Padding());
     o.SetBoolean("xiphCommentReadable", conf->XIPHCommentReadable());
     o.SetBoolean("xiphCommentWritable", conf->XIPHCommentWritable());
-}
-
-void ImportConfiguration(v8::Object *object, Configuration *conf) {
-    TagLibWrapper o(object);
-    conf->SetFileExtracted(FileExtractedAsCode(o.GetString("fileExtracted")));
-    conf->SetFileDirectory(o.GetString("fileDirectory"));
-    conf->SetFileUrlPrefix(o.GetString("fileUrlPrefix"));
-    conf->SetConfigurationReadable(o.GetBoolean("configurationReadable"));
-    conf->SetAudioPropertiesReadable(o.GetBoolean("audioPropertiesReadable"));
-    conf->SetTagReadable(o.GetBoolean("tagReadable"));
-    conf->SetAPEReadable(o.GetBoolean("apeReadable"));
-    conf->SetAPEWritable(o.GetBoolean("apeWritable"));
-    conf->SetID3v1Readable(o.GetBoolean("id3v1Readable"));
-    conf->SetID3v1Writable(o.GetBoolean("id3v1Writable"));
-    conf->SetID3v1Encoding(o.GetEncoding("id3v1Encoding"));
-    conf->SetID3v2Readable(o.GetBoolean("id3v2Readable"));
-    conf->SetID3v2Writable(o.GetBoolean("id3v2Writable"));
-    conf->SetID3v2Encoding(o.GetEncoding("id3v2Encoding"));
-    conf->SetID3v2Version(o.GetUint32("id3v2Version"));
-    conf->SetID3v2UseFrameEncoding(o.GetBoolean("id3v2UseFrameEncoding"));
-    conf->SetXIPHCommentReadable(o.GetBoolean("xiphCommentReadable"));
-    conf->SetXIPHCommentWritable(o.GetBoolean("xiphCommentWritable"));
+    o.SetUint32("xiphCommentPadding", conf->XIPHCommentPadding());
+    o.SetBoolean("mp4Readable", conf->MP4Readable());
+    o.SetBoolean("mp4Writable", conf->MP4Writable());
+    o.SetUint32("threads", conf->Threads());
+    o.SetUint32("queueSize", conf->QueueSize());
+    o.SetUint32("queueLimit", conf->QueueLimit());
 }
@@ -1,15 +1,26 @@
 #ifndef TAGIO_CONFIGURATION_H
 #define TAGIO_CONFIGURATION_H
 
-#include <node.h>
 #include <string>
 #include <taglib/tstring.h>
+#include <taglib/audioproperties.h>
+#include "result.h"
+#include "projection.h"
 
 
 const int FILE_EXTRACTED_IS_IGNORED = 1;     // Ignore attached files
 const int FILE_EXTRACTED_AS_FILENAME = 2;     // JSON contains just the filename -> somefile.ext
 const int FILE_EXTRACTED_AS_ABSOLUTE_URL = 3; // JSON contains compete file URL -> file://somepath/somefile.ext
 const int FILE_EXTRACTED_AS_RELATIVE_URL = 4; // JSON contains file URL with given prefix -> /somepath/somefile.ext
+const int FILE_EXTRACTED_AS_BUFFER = 5;       // JSON contains Buffer sharing data with TagLib -> no file is written
+const int FILE_EXTRACTED_AS_HANDLE = 6;       // JSON contains size, offset and length of data in the audio file -> nothing is copied
+
+const int FILE_HASH_XXH3 = 1; // Fast non-cryptographic hash -> 16 hex characters
+const int FILE_HASH_MD5 = 2;  // Compatible with older versions -> 32 hex characters
+
+const int AUDIO_PROPERTIES_FAST = 1;     // Read as little of audio data as possible
+const int AUDIO_PROPERTIES_AVERAGE = 2;  // TagLib default
+const int AUDIO_PROPERTIES_ACCURATE = 3; // Read as much as needed for accurate values (e.g. VBR length)
 
 class Configuration {
 public:
@@ -23,17 +34,45 @@ public:
     TagLib::String FileDirectory() { return fileDirectory; }
     void SetFileDirectory(TagLib::String dir) { fileDirectory = dir; }
     
+    int FileHash() { return fileHash; }
+    void SetFileHash(int hash) { fileHash = hash; }
+
     TagLib::String FileUrlPrefix() { return fileUrlPrefix; }
     void SetFileUrlPrefix(TagLib::String prefix) { fileUrlPrefix = prefix; }
 
+    TagLib::String CacheDirectory() { return cacheDirectory; }
+    void SetCacheDirectory(TagLib::String dir) { cacheDirectory = dir; }
+
+    uint32_t ImportCacheSize() { return importCacheSize; }
+    void SetImportCacheSize(uint32_t size) { importCacheSize = size; }
+
     bool ConfigurationReadable() { return configurationReadable; }
     void SetConfigurationReadable(bool b) { configurationReadable = b; }
 
     bool AudioPropertiesReadable() { return audioPropertiesReadable; }
     void SetAudioPropertiesReadable(bool b) { audioPropertiesReadable = b; }
 
+    int AudioPropertiesStyle() { return audioPropertiesStyle; }
+    void SetAudioPropertiesStyle(int style) { audioPropertiesStyle = style; }
+
+    // Files are opened without audio properties when they are not readable,
+    // only tags at the head and tail of the file are read then.
+    TagLib::AudioProperties::ReadStyle AudioPropertiesReadStyle() {
+        switch (audioPropertiesStyle) {
+            case AUDIO_PROPERTIES_FAST:
+                return TagLib::AudioProperties::Fast;
+            case AUDIO_PROPERTIES_ACCURATE:
+                return TagLib::AudioProperties::Accurate;
+            default:
+                return TagLib::AudioProperties::Average;
+        }
+    }
+
     bool TagReadable() { return tagReadable; }
     void SetTagReadable(bool b) { tagReadable = b; }
+
+    bool TimingsReadable() { return timingsReadable; }
+    void SetTimingsReadable(bool b) { timingsReadable = b; }
     
     bool APEWritable() { return apeWritable; }
     void SetAPEWritable(bool b) { apeWritable = b; }
@@ -65,12 +104,36 @@ public:
     bool ID3v2UseFrameEncoding() { return id3v2UseFrameEncoding; }
     void SetID3v2UseFrameEncoding(bool b) { id3v2UseFrameEncoding = b; }
 
+    uint32_t ID3v2Padding() { return id3v2Padding; }
+    void SetID3v2Padding(uint32_t size) { id3v2Padding = size; }
+
     bool XIPHCommentWritable() { return xiphCommentWritable; }
     void SetXIPHCommentWritable(bool b) { xiphCommentWritable = b; }
 
     bool XIPHCommentReadable() { return xiphCommentReadable; }
     void SetXIPHCommentReadable(bool b) { xiphCommentReadable = b; }
 
+    uint32_t XIPHCommentPadding() { return xiphCommentPadding; }
+    void SetXIPHCommentPadding(uint32_t size) { xiphCommentPadding = size; }
+
+    bool MP4Writable() { return mp4Writable; }
+    void SetMP4Writable(bool b) { mp4Writable = b; }
+
+    bool MP4Readable() { return mp4Readable; }
+    void SetMP4Readable(bool b) { mp4Readable = b; }
+
+    uint32_t Threads() { return threads; }
+    void SetThreads(uint32_t count) { threads = count; }
+
+    uint32_t QueueSize() { return queueSize; }
+    void SetQueueSize(uint32_t size) { queueSize = size; }
+
+    uint32_t QueueLimit() { return queueLimit; }
+    void SetQueueLimit(uint32_t limit) { queueLimit = limit; }
+
+    // Set by the read request, not part of the exported configuration.
+    Projection &Fields() { return fields; }
+
 
 private:
     Configuration(Configuration const&)   = delete;
@@ -79,11 +142,16 @@ private:
 
     int            fileExtracted = FILE_EXTRACTED_AS_FILENAME;
     TagLib::String fileDirectory = ".";
+    int            fileHash = FILE_HASH_XXH3;
     TagLib::String fileUrlPrefix = "";
+    TagLib::String cacheDirectory = ""; // metadata cache is disabled when empty
+    uint32_t       importCacheSize = 64 * 1024 * 1024; // bytes of imported attachments kept in memory, 0 disables
 
     bool configurationReadable = false;
     bool audioPropertiesReadable = true;
+    int  audioPropertiesStyle = AUDIO_PROPERTIES_AVERAGE;
     bool tagReadable = true;
+    bool timingsReadable = false;   // per-phase timings of the request, see timings.h
 
     bool apeWritable = false;
     bool apeReadable = false;
@@ -97,12 +165,23 @@ private:
     uint32_t id3v2Version = 4;
     TagLib::String::Type id3v2Encoding = TagLib::String::UTF8;
     bool id3v2UseFrameEncoding = false;
+    uint32_t id3v2Padding = 4096;   // reserved when the tag grows, later writes fit in place
 
     bool xiphCommentWritable = true;
     bool xiphCommentReadable = true;
+    uint32_t xiphCommentPadding = 4096; // reserved when Ogg comment grows, later writes fit in place
+
+    bool mp4Writable = true;
+    bool mp4Readable = true;
+
+    uint32_t threads = 0;       // thread pool size, 0 = number of CPUs
+    uint32_t queueSize = 256;   // max requests handed over to the pool at once
+    uint32_t queueLimit = 4096; // max requests waiting for the pool, further ones are rejected
+
+    Projection fields;
 };
 
-void ExportConfiguration(Configuration *configuration, v8::Object *object);
+void ExportConfiguration(Configuration *configuration, Result *object);
 void ImportConfiguration(v8::Object *object, Configuration *configuration);
 
 
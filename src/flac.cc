@@ -1,6 +1,7 @@
 #include <taglib/generalencapsulatedobjectframe.h>
 #include "flac.h"
 #include "configuration.h"
+#include "cache.h"
 #include "audioproperties.h"
 #include "bytevector.h"
 #include "tag.h"
@@ -8,6 +9,9 @@
 #include "id3v1tag.h"
 #include "id3v2tag.h"
 #include "xiphcomment.h"
+#include "flacpicture.h"
+#include "patch.h"
+#include "timings.h"
 
 #include "taglib/flacfile.h"
 #include "taglib/id3v1tag.h"
@@ -18,129 +22,66 @@
 
 using std::string;
 using std::map;
-using v8::Function;
-using v8::Local;
-using v8::Value;
-using v8::String;
-using v8::Object;
-using v8::Array;
-using Nan::AsyncQueueWorker;
-using Nan::AsyncWorker;
-using Nan::Callback;
-using Nan::HandleScope;
-using Nan::New;
-using Nan::Null;
-using Nan::To;
+using std::vector;
 
-class FLACWorker : public AsyncWorker {
+class FLACReader : public Reader {
 public:
-    FLACWorker(Callback *callback, string *path, Configuration *conf)
-            : AsyncWorker(callback), path(path), conf(conf) {}
+    FLACReader(const string &path, Configuration *conf) : Reader(path, conf) {}
 
-    FLACWorker(Callback *callback,
-               string *path,
-               Configuration *conf,
-               TagLib::ID3v1::Tag *id3v1Tag,
-               TagLib::ID3v2::Tag *id3v2Tag,
-               TagLib::Ogg::XiphComment *xiphComment,
-               std::map<uintptr_t, std::string> *fmap)
-    : save(true),
-    AsyncWorker(callback),
-    path(path),
-    conf(conf),
-    id3v1Tag(id3v1Tag),
-    id3v2Tag(id3v2Tag),
-    xiphComment(xiphComment),
-    fmap(fmap) {}
+    // Takes ownership of already opened (and saved) file.
+    FLACReader(const string &path, Configuration *conf, TagLib::FLAC::File *file)
+            : Reader(path, conf), file(file) {}
 
-
-    ~FLACWorker() {
-        delete path;
-        delete conf;
+    ~FLACReader() {
         delete file;
     }
 
-    void Execute () {
-        file = new TagLib::FLAC::File(path->c_str());
-        if (save) {
-            if (conf->ID3v1Writable()) WriteID3v1();
-            if (conf->ID3v2Writable()) WriteID3v2();
-            if (conf->XIPHCommentWritable()) WriteXIPHComment();
-            file->save();
-            delete file;
-            delete id3v1Tag;
-            delete id3v2Tag;
-            delete xiphComment;
-        }
-        file = new TagLib::FLAC::File(path->c_str());
+protected:
+    bool OpenFile() {
+        if (file == nullptr) file = new TagLib::FLAC::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
         audioProperties = file->audioProperties();
         tag = file->tag();
         id3v1Tag = file->hasID3v1Tag() ? file->ID3v1Tag(false) : nullptr;
         id3v2Tag = file->hasID3v2Tag() ? file->ID3v2Tag(false) : nullptr;
         xiphComment = file->hasXiphComment() ? file->xiphComment(false) : nullptr;
+        return file->isValid();
     }
 
-    void HandleOKCallback () {
-        //std::cout << conf->fileDirectory() << std::endl;
-        HandleScope scope;
-        Local<Object> result= New<Object>();
-
-        Local<String> pathKey = New<String>("path").ToLocalChecked();
-        Local<String> pathVal = New<String>(path->c_str()).ToLocalChecked();
-        result->Set(pathKey, pathVal);
-
-        if (conf->ConfigurationReadable()) {
-            Local<String> confKey = New<String>("configuration").ToLocalChecked();
-            Local<Object> confVal = New<Object>();
-            ExportConfiguration(conf, *confVal);
-            result->Set(confKey, confVal);
-        }
+    void ExportTags(Result *result) {
+        const Projection &fields = conf->Fields();
 
-        if (conf->AudioPropertiesReadable()) {
-            Local<String> audioPropertiesKey = New<String>("audioProperties").ToLocalChecked();
-            Local<Object> audioPropertiesVal = New<Object>();
-            ExportAudioProperties(audioProperties, *audioPropertiesVal);
-            result->Set(audioPropertiesKey, audioPropertiesVal);
+        if (conf->AudioPropertiesReadable() && audioProperties != nullptr) {
+            ExportAudioProperties(audioProperties, result->SetObject("audioProperties", SHAPE_AUDIO_PROPERTIES));
         }
 
         if (conf->TagReadable()) {
-            Local<String> tagKey = New<String>("tag").ToLocalChecked();
-            Local<Object> tagVal = New<Object>();
-            ExportTag(tag, *tagVal);
-            result->Set(tagKey, tagVal);
+            ExportTag(tag, result->SetObject("tag", fields.Shape(SHAPE_TAG)), fields);
         }
 
         if (conf->ID3v1Readable() && id3v1Tag != nullptr) {
-            Local<String> id3v1Key = New<String>("id3v1").ToLocalChecked();
-            Local<Object> id3v1Val = New<Object>();
-            ExportID3v1Tag(id3v1Tag, *id3v1Val);
-            result->Set(id3v1Key, id3v1Val);
+            ExportID3v1Tag(id3v1Tag, result->SetObject("id3v1", fields.Shape(SHAPE_ID3V1)), fields);
         }
 
         if (conf->ID3v2Readable() && id3v2Tag != nullptr) {
-            Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
-            Local<Array> id3v2Val = New<Array>(id3v2Tag->frameList().size());
-            ExportID3v2Tag(id3v2Tag, *id3v2Val, conf);
-            result->Set(id3v2Key, id3v2Val);
+            ExportID3v2Tag(id3v2Tag, result->SetArray("id3v2", id3v2Tag->frameList().size()), path, conf);
         }
 
         if (conf->XIPHCommentReadable() && xiphComment != nullptr) {
-            Local<String> xiphKey = New<String>("xiphComment").ToLocalChecked();
-            Local<Array> xiphVal = New<Array>(xiphComment->fieldCount());
-            ExportXiphComment(xiphComment, *xiphVal);
-            result->Set(xiphKey, xiphVal);
+            ExportXiphComment(xiphComment, result->SetArray("xiphComment", xiphComment->fieldCount()), fields);
         }
 
-        Local<Value> argv[] = { Null(), result };
-        callback->Call(2, argv);
+        if (conf->XIPHCommentReadable() && fields.Has("pictures")) {
+            const TagLib::List<TagLib::FLAC::Picture *> pictures = file->pictureList();
+            if (!pictures.isEmpty()) {
+                AttachmentSource source;
+                if (conf->FileExtracted() == FILE_EXTRACTED_AS_HANDLE) source.Locate(path, pictures);
+                ExportFLACPictures(pictures, result->SetArray("pictures", pictures.size()), source, conf);
+            }
+        }
     }
 
-
 private:
-    bool save = false;
-    string *path;
-    Configuration *conf;
-    TagLib::FLAC::File *file;
+    TagLib::FLAC::File *file = nullptr;
 
     // extracted
     TagLib::FLAC::Properties *audioProperties;
@@ -148,14 +89,30 @@ private:
     TagLib::ID3v1::Tag *id3v1Tag;
     TagLib::ID3v2::Tag *id3v2Tag;
     TagLib::Ogg::XiphComment *xiphComment;
-    std::map<uintptr_t, std::string> *fmap;
-
-    void WriteID3v1();
-    void WriteID3v2();
-    void WriteXIPHComment();
 };
 
-inline void FLACWorker::WriteID3v1() {
+Reader *NewFLACReader(const string &path, Configuration *conf) {
+    return new FLACReader(path, conf);
+}
+
+static TagLib::FLAC::File *OpenFLACFile(const string &path, Configuration *conf) {
+    PhaseTimer timer(PHASE_OPEN);
+    return new TagLib::FLAC::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
+}
+
+// Saved file is exported from memory, null file (verify) is read again. The file is
+// closed and the result fully converted before leaving the worker thread.
+static void ExportFLACFile(const string &path, Configuration *conf, TagLib::FLAC::File *file, Result *result) {
+    FLACReader reader(path, conf, file);
+    if (file == nullptr) {
+        reader.Read(result);
+    } else {
+        reader.Open();
+        reader.Export(result);
+    }
+}
+
+static void WriteID3v1(TagLib::FLAC::File *file, TagLib::ID3v1::Tag *id3v1Tag) {
     TagLib::ID3v1::Tag *t1 = file->ID3v1Tag(true);
     t1->setArtist(id3v1Tag->artist());
     t1->setAlbum(id3v1Tag->album());
@@ -167,10 +124,9 @@ inline void FLACWorker::WriteID3v1() {
     t1->setComment(id3v1Tag->comment());
 }
 
-inline void FLACWorker::WriteID3v2() {
+static void WriteID3v2(TagLib::FLAC::File *file, TagLib::ID3v2::Tag *id3v2Tag, const map<uintptr_t, string> &fmap, Configuration *conf) {
     TagLib::ID3v2::Tag *t2 = file->ID3v2Tag(true);
     TagLib::ID3v2::FrameList l2 = id3v2Tag->frameList();
-    TagLib::ID3v2::FrameFactory *factory = TagLib::ID3v2::FrameFactory::instance();
 
     //TODO: Clear all frames not only added!
     for (unsigned int i = 0; i < l2.size(); i++) {
@@ -178,29 +134,10 @@ inline void FLACWorker::WriteID3v2() {
         t2->removeFrames(frame->frameID());
     }
 
-    for (unsigned int i = 0; i < l2.size(); i++) {
-        TagLib::ID3v2::Frame *frame = l2[i];
-        if (auto f = dynamic_cast<TagLib::ID3v2::AttachedPictureFrame *>(frame)) {
-            uintptr_t addr = (uintptr_t) frame;
-            std::string path = (*fmap)[addr];
-            f->setPicture(ImportByteVector(path, conf));
-        }
-        if (auto f = dynamic_cast<TagLib::ID3v2::GeneralEncapsulatedObjectFrame *>(frame)) {
-            uintptr_t addr = (uintptr_t) frame;
-            std::string path = (*fmap)[addr];
-            f->setObject(ImportByteVector(path, conf));
-        }
-        if (auto f = dynamic_cast<TagLib::ID3v2::UniqueFileIdentifierFrame *>(frame)) {
-            uintptr_t addr = (uintptr_t) frame;
-            std::string path = (*fmap)[addr];
-            f->setIdentifier(ImportByteVector(path, conf));
-        }
-        //TODO: Slow but safe?
-        t2->addFrame(factory->createFrame(frame->render(), conf->ID3v2Version()));
-    }
+    MoveID3v2Frames(id3v2Tag, t2, fmap, conf);
 }
 
-inline void FLACWorker::WriteXIPHComment() {
+static void WriteXIPHComment(TagLib::FLAC::File *file, TagLib::Ogg::XiphComment *xiphComment) {
     TagLib::Ogg::XiphComment *t = file->xiphComment(true);
     ClearXiphComment(t);
     const TagLib::Ogg::FieldListMap map = xiphComment->fieldListMap();
@@ -211,62 +148,60 @@ inline void FLACWorker::WriteXIPHComment() {
     }
 }
 
-NAN_METHOD(ReadFLAC) {
-    Local<Object> reqObj = info[0].As<Object>();
-    Callback *callback = new Callback(info[1].As<Function>());
-
-    Local<String> pathKey = New<String>("path").ToLocalChecked();
-    Local<String> pathObj = reqObj->Get(pathKey).As<String>();
-    String::Utf8Value pathVal(pathObj);
-    std::string *path = new std::string(*pathVal);
-
-    Local<String> confKey = New<String>("configuration").ToLocalChecked();
-    Local<Object> confVal = reqObj->Get(confKey).As<Object>();
-    Configuration *conf = new Configuration();
-    ImportConfiguration(*confVal, conf);
-
-    AsyncQueueWorker(new FLACWorker(callback, path, conf));
+// Pictures of the request replace all pictures of the file, the file owns them then.
+static void WritePictures(TagLib::FLAC::File *file, vector<TagLib::FLAC::Picture *> *pictures,
+                          const map<uintptr_t, string> &fmap, Configuration *conf) {
+    file->removePictures();
+    for (auto picture : *pictures) {
+        LoadFLACPicture(picture, fmap, conf);
+        file->addPicture(picture);
+    }
+    pictures->clear();
 }
 
-NAN_METHOD(WriteFLAC) {
-    Configuration *conf = new Configuration();
-    TagLib::ID3v1::Tag *id3v1Tag = new TagLib::ID3v1::Tag();
-    TagLib::ID3v2::Tag *id3v2Tag = new TagLib::ID3v2::Tag();
-    TagLib::Ogg::XiphComment *xiphComment = new TagLib::Ogg::XiphComment();
-    std::map<uintptr_t, std::string> *fmap = new std::map<uintptr_t, std::string>();
-
-    Local<Object> reqObj = info[0].As<Object>();
-    Callback *callback = new Callback(info[1].As<Function>());
-
-    Local<String> pathKey = New<String>("path").ToLocalChecked();
-    Local<String> confKey = New<String>("configuration").ToLocalChecked();
-    Local<String> id3v1Key = New<String>("id3v1").ToLocalChecked();
-    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
-    Local<String> xiphCommentKey = New<String>("xiphComment").ToLocalChecked();
-
-    Local<String> pathObj = reqObj->Get(pathKey).As<String>();
-    String::Utf8Value pathVal(pathObj);
-    std::string *path = new std::string(*pathVal);
-
-    if (reqObj->Has(confKey)) {
-        Local<Object> confVal = reqObj->Get(confKey).As<Object>();
-        ImportConfiguration(*confVal, conf);
+void WriteFLACFile(const string &path, Configuration *conf, TagLib::ID3v1::Tag *id3v1Tag, TagLib::ID3v2::Tag *id3v2Tag,
+                   TagLib::Ogg::XiphComment *xiphComment, vector<TagLib::FLAC::Picture *> *pictures,
+                   const map<uintptr_t, string> &fmap, bool verify, Result *result) {
+    TagLib::FLAC::File *file = OpenFLACFile(path, conf);
+    if (conf->ID3v1Writable()) WriteID3v1(file, id3v1Tag);
+    if (conf->ID3v2Writable()) WriteID3v2(file, id3v2Tag, fmap, conf);
+    if (conf->XIPHCommentWritable()) WriteXIPHComment(file, xiphComment);
+    if (pictures != nullptr) WritePictures(file, pictures, fmap, conf);
+    {
+        PhaseTimer timer(PHASE_SAVE);
+        file->save();
     }
-
-    if (conf->ID3v1Writable() && reqObj->Has(id3v1Key)) {
-        Local<Object> id3v1Val = reqObj->Get(id3v1Key).As<Object>();
-        ImportID3v1Tag(*id3v1Val, id3v1Tag, conf);
+    InvalidateMetadataCache(path, conf);
+    // response is built from saved in-memory tags unless re-read is requested
+    if (verify) {
+        delete file;
+        file = nullptr;
     }
+    ExportFLACFile(path, conf, file, result);
+}
 
-    if (conf->ID3v2Writable() && reqObj->Has(id3v2Key)) {
-        Local<Array> id3v2Val = reqObj->Get(id3v2Key).As<Array>();
-        ImportID3v2Tag(*id3v2Val, id3v2Tag, fmap, conf);
+// File is saved only when the patch changed some of its tags (pictures).
+static bool PatchFLACTags(TagLib::FLAC::File *file, TagPatch *patch, Configuration *conf) {
+    if (!file->isValid()) return false;
+    bool changed = false;
+    if (patch->HasID3v2()) changed = patch->Apply(file->ID3v2Tag(true), conf) || changed;
+    if (patch->HasXiphComment()) changed = patch->Apply(file->xiphComment(true)) || changed;
+    if (patch->HasPictures()) changed = patch->Apply(file) || changed;
+    if (changed) {
+        PhaseTimer timer(PHASE_SAVE);
+        file->save();
     }
+    return changed;
+}
 
-    if (conf->XIPHCommentWritable() && reqObj->Has(xiphCommentKey)) {
-        Local<Array> apeVal = reqObj->Get(xiphCommentKey).As<Array>();
-        ImportXiphComment(*apeVal, xiphComment);
+void PatchFLACFile(const string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result) {
+    TagLib::FLAC::File *file = OpenFLACFile(path, conf);
+    bool changed = PatchFLACTags(file, patch, conf);
+    if (changed) InvalidateMetadataCache(path, conf);
+    if (changed && verify) {
+        delete file;
+        file = nullptr;
     }
-
-    AsyncQueueWorker(new FLACWorker(callback, path, conf, id3v1Tag, id3v2Tag, xiphComment, fmap));
+    ExportFLACFile(path, conf, file, result);
+    result->SetBoolean("changed", changed);
 }
@@ -1,10 +1,28 @@
 #ifndef TAGIO_FLAC_H
 #define TAGIO_FLAC_H
 
-#include <nan.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <taglib/id3v1tag.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/xiphcomment.h>
+#include <taglib/flacpicture.h>
 
-NAN_METHOD(ReadFLAC);
-NAN_METHOD(WriteFLAC);
+#include "reader.h"
+#include "patch.h"
+
+Reader *NewFLACReader(const std::string &path, Configuration *conf);
+
+// Replaces the writable tags of the file by the imported ones and exports the
+// response from the saved tags, re-read with verify (worker thread). Pictures
+// (when given) replace all pictures of the file, which takes them from the vector.
+void WriteFLACFile(const std::string &path, Configuration *conf, TagLib::ID3v1::Tag *id3v1Tag, TagLib::ID3v2::Tag *id3v2Tag,
+                   TagLib::Ogg::XiphComment *xiphComment, std::vector<TagLib::FLAC::Picture *> *pictures,
+                   const std::map<uintptr_t, std::string> &fmap, bool verify, Result *result);
+
+// Patches the file and exports the response with "changed" (worker thread).
+void PatchFLACFile(const std::string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result);
 
 
 #endif //TAGIO_FLAC_H
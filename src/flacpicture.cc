@@ -0,0 +1,25 @@
+#include "flacpicture.h"
+#include "wrapper.h"
+#include "bytevector.h"
+
+
+void ExportFLACPictures(const TagLib::List<TagLib::FLAC::Picture *> &pictures, Result *array,
+                        const AttachmentSource &source, Configuration *conf) {
+    for (auto it = pictures.begin(); it != pictures.end(); it++) {
+        TagLib::FLAC::Picture *picture = *it;
+        TagLibWrapper o(array->PushObject());
+        o.SetUint32("type", picture->type());
+        o.SetString("mimeType", picture->mimeType());
+        o.SetString("description", picture->description());
+        o.SetInt32("width", picture->width());
+        o.SetInt32("height", picture->height());
+        o.SetInt32("colorDepth", picture->colorDepth());
+        o.SetInt32("numColors", picture->numColors());
+        ExportByteVector(o, "picture", picture->data(), picture->mimeType(), conf, source.Find(picture));
+    }
+}
+
+void LoadFLACPicture(TagLib::FLAC::Picture *picture, const std::map<uintptr_t, std::string> &fmap, Configuration *conf) {
+    auto it = fmap.find((uintptr_t) picture);
+    if (it != fmap.end()) picture->setData(ImportByteVector(it->second, conf));
+}
@@ -0,0 +1,25 @@
+#ifndef TAGIO_FLAC_PICTURE_H
+#define TAGIO_FLAC_PICTURE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <taglib/flacpicture.h>
+
+#include "configuration.h"
+#include "attachment.h"
+#include "result.h"
+
+// METADATA_BLOCK_PICTURE blocks of FLAC file - exported like APIC frames,
+// picture data goes through the same attachment pipeline (fileExtracted).
+void ExportFLACPictures(const TagLib::List<TagLib::FLAC::Picture *> &pictures, Result *array,
+                        const AttachmentSource &source, Configuration *conf);
+
+// Pictures given as file name are recorded in fmap and read on the worker thread.
+void ImportFLACPictures(v8::Array *array, std::vector<TagLib::FLAC::Picture *> *pictures,
+                        std::map<uintptr_t, std::string> *fmap);
+
+// Reads picture data recorded by ImportFLACPictures.
+void LoadFLACPicture(TagLib::FLAC::Picture *picture, const std::map<uintptr_t, std::string> &fmap, Configuration *conf);
+
+#endif //TAGIO_FLAC_PICTURE_H
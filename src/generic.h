@@ -1,9 +1,15 @@
 #ifndef TAGIO_GENERIC_H
 #define TAGIO_GENERIC_H
 
-#include <nan.h>
+#include <string>
 
-NAN_METHOD(ReadGeneric);
-NAN_METHOD(WriteGeneric);
+#include "reader.h"
+#include "tag.h"
+
+Reader *NewGenericReader(const std::string &path, Configuration *conf);
+
+// Writes the tag through TagLib::FileRef and exports the response from the saved
+// tag, re-read with verify (worker thread).
+void WriteGenericFile(const std::string &path, Configuration *conf, const GenericTag &gtag, bool verify, Result *result);
 
 #endif //TAGIO_GENERIC_H
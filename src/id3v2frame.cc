@@ -17,47 +17,10 @@
 
 //TODO: chapterframe.h missing?
 
-using namespace v8;
 using namespace std;
 
-static map<TagLib::uint, TagLib::ID3v2::AttachedPictureFrame::Type> APIC = {
-    {0x00, TagLib::ID3v2::AttachedPictureFrame::Other},
-    {0x01, TagLib::ID3v2::AttachedPictureFrame::FileIcon},
-    {0x02, TagLib::ID3v2::AttachedPictureFrame::OtherFileIcon},
-    {0x03, TagLib::ID3v2::AttachedPictureFrame::FrontCover},
-    {0x04, TagLib::ID3v2::AttachedPictureFrame::BackCover},
-    {0x05, TagLib::ID3v2::AttachedPictureFrame::LeafletPage},
-    {0x06, TagLib::ID3v2::AttachedPictureFrame::Media},
-    {0x07, TagLib::ID3v2::AttachedPictureFrame::LeadArtist},
-    {0x08, TagLib::ID3v2::AttachedPictureFrame::Artist},
-    {0x09, TagLib::ID3v2::AttachedPictureFrame::Conductor},
-    {0x0A, TagLib::ID3v2::AttachedPictureFrame::Band},
-    {0x0B, TagLib::ID3v2::AttachedPictureFrame::Composer},
-    {0x0C, TagLib::ID3v2::AttachedPictureFrame::Lyricist},
-    {0x0D, TagLib::ID3v2::AttachedPictureFrame::RecordingLocation},
-    {0x0E, TagLib::ID3v2::AttachedPictureFrame::DuringRecording},
-    {0x0F, TagLib::ID3v2::AttachedPictureFrame::DuringPerformance},
-    {0x10, TagLib::ID3v2::AttachedPictureFrame::MovieScreenCapture},
-    {0x11, TagLib::ID3v2::AttachedPictureFrame::ColouredFish},
-    {0x12, TagLib::ID3v2::AttachedPictureFrame::Illustration},
-    {0x13, TagLib::ID3v2::AttachedPictureFrame::BandLogo},
-    {0x14, TagLib::ID3v2::AttachedPictureFrame::PublisherLogo}
-};
-
-static map<TagLib::uint, TagLib::ID3v2::RelativeVolumeFrame::ChannelType> RVA2 = {
-    {0x00, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::Other},
-    {0x01, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::MasterVolume},
-    {0x02, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::FrontRight},
-    {0x03, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::FrontLeft},
-    {0x04, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::BackRight},
-    {0x05, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::BackLeft},
-    {0x06, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::FrontCentre},
-    {0x07, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::BackCentre},
-    {0x08, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::Subwoofer}
-};
-
 
-static inline void GetTXXX(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetTXXX(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::UserTextIdentificationFrame *>(frame);
     string s1 = f->description().to8Bit(true);
     string s2 = "[" + s1 + "] " + s1 + " "; // yes - so stupid
@@ -69,169 +32,61 @@ static inline void GetTXXX(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Config
     o.SetString("text", text);
 }
 
-static inline void SetTXXX(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Configuration *conf) {
-    auto *f= new TagLib::ID3v2::UserTextIdentificationFrame(TagLib::String::UTF8);
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setDescription(o.GetString("description"));
-    f->setText(o.GetString("text"));
-    tag->addFrame(f);
-}
-
-static inline void GetTYYY(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetTYYY(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::TextIdentificationFrame *>(frame);
     if (conf->ID3v2UseFrameEncoding()) o.SetEncoding("textEncoding", f->textEncoding());
     o.SetString("text", f->toString());
 }
 
-static inline void SetTYYY(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, const TagLib::ByteVector &id, Configuration *conf) {
-    auto *f= new TagLib::ID3v2::TextIdentificationFrame(id, TagLib::String::UTF8);
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setText(o.GetString("text"));
-    tag->addFrame(f);
-}
-
-static inline void GetWXXX(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetWXXX(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::UserUrlLinkFrame *>(frame);
     if (conf->ID3v2UseFrameEncoding()) o.SetEncoding("textEncoding", f->textEncoding());
     o.SetString("description", f->description());
     o.SetString("url", f->url());
 }
 
-static inline void SetWXXX(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Configuration *conf) {
-    auto *f = new TagLib::ID3v2::UserUrlLinkFrame();
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setDescription(o.GetString("description"));
-    f->setUrl(o.GetString("url"));
-    tag->addFrame(f);
-}
-
-static inline void GetWYYY(TagLibWrapper &o, TagLib::ID3v2::Frame *frame) {
+static inline void GetWYYY(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::UrlLinkFrame *>(frame);
     o.SetString("url", f->url());
 }
 
-static inline void SetWYYY(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, const TagLib::ByteVector &id) {
-    auto *f = new TagLib::ID3v2::UrlLinkFrame(id);
-    f->setUrl(o.GetString("url"));
-    tag->addFrame(f);
-}
-
-static inline void GetCOMM(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetCOMM(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::CommentsFrame *>(frame);
     if (conf->ID3v2UseFrameEncoding()) o.SetEncoding("textEncoding", f->textEncoding());
     o.SetString("text", f->toString());
 }
 
-static inline void SetCOMM(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Configuration *conf) {
-    auto *f = new TagLib::ID3v2::CommentsFrame();
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setText(o.GetString("text"));
-    tag->addFrame(f);
-}
-
-static inline void GetAPIC(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetAPIC(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::AttachedPictureFrame *>(frame);
     if (conf->ID3v2UseFrameEncoding()) o.SetEncoding("textEncoding", f->textEncoding());
     o.SetString("mimeType", f->mimeType());
     o.SetString("description", f->description());
     o.SetUint32("type", f->type());
-    o.SetString("picture", ExportByteVector(f->picture(), f->mimeType(), conf));
-}
-
-static inline void SetAPIC(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Configuration *conf) {
-    uint32_t type = o.GetUint32("type");
-    auto *f = new TagLib::ID3v2::AttachedPictureFrame();
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setMimeType(o.GetString("mimeType"));
-    if (APIC.count(type)) f->setType(APIC[type]);
-    else f->setType(TagLib::ID3v2::AttachedPictureFrame::Other);
-    f->setDescription(o.GetString("description"));
-    f->setPicture(ImportByteVector(o.GetString("picture"), conf));
-    tag->addFrame(f);
+    ExportByteVector(o, "picture", f->picture(), f->mimeType(), conf, source.Find(frame));
 }
 
-static inline void SetAPIC(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf) {
-    uint32_t type = o.GetUint32("type");
-    auto *f = new TagLib::ID3v2::AttachedPictureFrame();
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setMimeType(o.GetString("mimeType"));
-    if (APIC.count(type)) f->setType(APIC[type]);
-    else f->setType(TagLib::ID3v2::AttachedPictureFrame::Other);
-    f->setDescription(o.GetString("description"));
-    (*fmap)[(uintptr_t) f] = o.GetString("picture").to8Bit(true);
-    tag->addFrame(f);
-}
-
-static inline void GetGEOB(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetGEOB(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::GeneralEncapsulatedObjectFrame *>(frame);
     if (conf->ID3v2UseFrameEncoding()) o.SetEncoding("textEncoding", f->textEncoding());
     o.SetString("mimeType", f->mimeType());
     o.SetString("fileName", f->fileName());
     o.SetString("description", f->description());
-    o.SetString("object", ExportByteVector(f->object(), f->mimeType(), conf));
-}
-
-static inline void SetGEOB(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Configuration *conf) {
-    auto *f = new TagLib::ID3v2::GeneralEncapsulatedObjectFrame();
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setMimeType(o.GetString("mimeType"));
-    f->setFileName(o.GetString("fileName"));
-    f->setDescription(o.GetString("description"));
-    f->setObject(ImportByteVector(o.GetString("object"), conf));
-    tag->addFrame(f);
-}
-
-static inline void SetGEOB(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf) {
-    auto *f = new TagLib::ID3v2::GeneralEncapsulatedObjectFrame();
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setMimeType(o.GetString("mimeType"));
-    f->setFileName(o.GetString("fileName"));
-    f->setDescription(o.GetString("description"));
-    (*fmap)[(uintptr_t) f] = o.GetString("object").to8Bit(true);
-    tag->addFrame(f);
+    ExportByteVector(o, "object", f->object(), f->mimeType(), conf, source.Find(frame));
 }
 
 
-static inline void GetPOPM(TagLibWrapper &o, TagLib::ID3v2::Frame *frame) {
+static inline void GetPOPM(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::PopularimeterFrame *>(frame);
     o.SetString("email", f->email());
     o.SetInt32("rating", f->rating()); // 0 - 255
     o.SetUint32("counter", f->counter());
 }
 
-static inline void SetPOPM(TagLibWrapper &o, TagLib::ID3v2::Tag *tag) {
-    auto *f = new TagLib::ID3v2::PopularimeterFrame();
-    f->setEmail(o.GetString("email"));
-    f->setRating(o.GetInt32("rating")); // 0 - 255
-    f->setCounter(o.GetUint32("counter"));
-    tag->addFrame(f);
-}
-
-static inline void GetPRIV(TagLibWrapper &o, TagLib::ID3v2::Frame *frame) {
+static inline void GetPRIV(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::PrivateFrame *>(frame);
     o.SetString("owner", f->owner());
 }
 
-static inline void SetPRIV(TagLibWrapper &o, TagLib::ID3v2::Tag *tag) {
-    auto *f = new TagLib::ID3v2::PrivateFrame();
-    f->setOwner(o.GetString("owner"));
-    tag->addFrame(f);
-}
-
 //static inline void GetRVA2(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Isolate *isolate, Object *object) {
 //    //TODO: Test RVA2 usability
 //    auto *f = dynamic_cast<TagLib::ID3v2::RelativeVolumeFrame *>(frame);
@@ -250,40 +105,15 @@ static inline void SetPRIV(TagLibWrapper &o, TagLib::ID3v2::Tag *tag) {
 //    }
 //    object->Set(String::NewFromUtf8(isolate, "channels"), channelArray);
 //}
-//
-//static inline void SetRVA2(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Isolate *isolate, Object *object) {
-//    //TODO: Test RVA2 usability
-//    Local<Array> channelArray = Local<Array>::Cast(object->Get(String::NewFromUtf8(isolate, "channels")));
-//    auto *f = new TagLib::ID3v2::RelativeVolumeFrame();
-//    for (unsigned int i = 0; i < channelArray->Length(); i++) {
-//        Local<Object> channelObject = channelArray->Get(i)->ToObject();
-//        TagLibWrapper co(isolate, *channelObject);
-//        TagLib::ID3v2::RelativeVolumeFrame::ChannelType channelType = RVA2[co.GetInt32("channelType")];
-//        float volumeAdjustment = (float) co.GetNumber("volumeAdjustment");
-//        TagLib::ID3v2::RelativeVolumeFrame::PeakVolume peakVolume;
-//        peakVolume.bitsRepresentingPeak = (unsigned char) co.GetString("bitsRepresentingPeak")[0];
-//        peakVolume.peakVolume = TagLib::ByteVector(co.GetString("peakVolume").toCString());
-//        f->setVolumeAdjustment(volumeAdjustment, channelType);
-//        f->setPeakVolume(peakVolume, channelType);
-//    }
-//    tag->addFrame(f);
-//}
 
-static inline void GetUFID(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetUFID(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::UniqueFileIdentifierFrame *>(frame);
     TagLib::String mimeType("data/bin", TagLib::String::UTF8); //TODO: Mime type
     o.SetString("owner", f->owner());
-    o.SetString("identifier", ExportByteVector(f->identifier(), mimeType, conf));
-}
-
-static inline void SetUFID(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id) {
-    TagLib::String owner = o.GetString("owner");
-    auto *f = new TagLib::ID3v2::UniqueFileIdentifierFrame(owner, id);
-    (*fmap)[(uintptr_t) f] = o.GetString("identifier").to8Bit(true);
-    tag->addFrame(f);
+    ExportByteVector(o, "identifier", f->identifier(), mimeType, conf);
 }
 
-static inline void GetUSLT(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Configuration *conf) {
+static inline void GetUSLT(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     auto *f = dynamic_cast<TagLib::ID3v2::UnsynchronizedLyricsFrame *>(frame);
     if (conf->ID3v2UseFrameEncoding()) o.SetEncoding("textEncoding", f->textEncoding());
     o.SetString("description", f->description());
@@ -291,66 +121,90 @@ static inline void GetUSLT(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, Config
     o.SetString("text", f->toString());
 }
 
-static inline void SetUSLT(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, const TagLib::ByteVector &id, Configuration *conf) {
-    auto *f = new TagLib::ID3v2::UnsynchronizedLyricsFrame(id);
-    TagLib::String languageString = o.GetString("language");
-    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
-    else f->setTextEncoding(conf->ID3v2Encoding());
-    f->setTextEncoding(conf->ID3v2Encoding());
-    f->setDescription(o.GetString("description"));
-    f->setLanguage(TagLib::ByteVector(languageString.toCString(false), languageString.size()));
-    f->setText(o.GetString("text"));
-    tag->addFrame(f);
-}
-
-static inline void GetNONE(TagLibWrapper &o, TagLib::ID3v2::Frame *frame) {
+static inline void GetNONE(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf) {
     //auto *f = dynamic_cast<TagLib::ID3v2::UnknownFrame *>(frame);
     //TODO: o.SetBytes("data", f->data(), "application/octet-stream");
 }
 
-static inline void SetNONE(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, const TagLib::ByteVector &id) {
-    //auto *f = new TagLib::ID3v2::UnknownFrame(o.GetBytes("data"));
-    //tag->addFrame(f);
+// Frame IDs packed to 32 bit integer - dispatch is single switch, no strings are allocated.
+static inline constexpr uint32_t FrameID(const char *id) {
+    return ((uint32_t) (unsigned char) id[0] << 24) | ((uint32_t) (unsigned char) id[1] << 16) |
+           ((uint32_t) (unsigned char) id[2] << 8) | ((uint32_t) (unsigned char) id[3]);
 }
 
-void ExportID3v2Frame(TagLib::ID3v2::Frame *frame, v8::Object *object, Configuration *conf) {
-    TagLibWrapper o(object);
-    TagLib::ByteVector idBytes = frame->frameID();
-    string id = string(idBytes.data(), idBytes.size());
-    o.SetString("id", TagLib::String(id));
-    if      (id.compare("TXXX") == 0) GetTXXX(o, frame, conf);
-    else if (id.at(0) == 'T')         GetTYYY(o, frame, conf);
-    else if (id.compare("WXXX") == 0) GetWXXX(o, frame, conf);
-    else if (id.at(0) == 'W')         GetWYYY(o, frame);
-    else if (id.compare("COMM") == 0) GetCOMM(o, frame, conf);
-    else if (id.compare("APIC") == 0) GetAPIC(o, frame, conf);
-    else if (id.compare("GEOB") == 0) GetGEOB(o, frame, conf);
-    else if (id.compare("POPM") == 0) GetPOPM(o, frame);
-    else if (id.compare("PRIV") == 0) GetPRIV(o, frame);
-    //TODO: Reimplement    
-    //else if (id.compare("RVA2") == 0) GetRVA2(o, frame, isolate, *object);
-    else if (id.compare("UFID") == 0) GetUFID(o, frame, conf);
-    else if (id.compare("USLT") == 0) GetUSLT(o, frame, conf);
-    else                              GetNONE(o, frame);
+static inline uint32_t FrameID(const char *id, size_t length) {
+    char packed[4] = { 0, 0, 0, 0 };
+    for (size_t i = 0; i < length && i < 4; i++) packed[i] = id[i];
+    return FrameID(packed);
+}
+
+typedef void (*FrameGetter)(TagLibWrapper &o, TagLib::ID3v2::Frame *frame, const AttachmentSource &source, Configuration *conf);
+
+struct FrameHandler {
+    FrameGetter get;
+    bool clearable; // removed by ClearID3v2Tag before import
+};
+
+// indexed by ID3v2FrameKind
+static const FrameHandler FRAME_HANDLERS[] = {
+    { GetTXXX, true },  // TXXX
+    { GetTYYY, true },  // TYYY
+    { GetWXXX, true },  // WXXX
+    { GetWYYY, true },  // WYYY
+    { GetCOMM, true },  // COMM
+    { GetAPIC, true },  // APIC
+    { GetGEOB, true },  // GEOB
+    { GetPOPM, true },  // POPM
+    { GetPRIV, true },  // PRIV
+    { GetNONE, true },  // RVA2 //TODO: Reimplement GetRVA2/SetRVA2
+    { GetUFID, true },  // UFID
+    { GetUSLT, true },  // USLT
+    { GetNONE, false }  // NONE
+};
+
+static inline ID3v2FrameKind FindFrameKind(uint32_t id) {
+    switch (id) {
+        case FrameID("TXXX"): return FRAME_TXXX;
+        case FrameID("WXXX"): return FRAME_WXXX;
+        case FrameID("COMM"): return FRAME_COMM;
+        case FrameID("APIC"): return FRAME_APIC;
+        case FrameID("GEOB"): return FRAME_GEOB;
+        case FrameID("POPM"): return FRAME_POPM;
+        case FrameID("PRIV"): return FRAME_PRIV;
+        case FrameID("RVA2"): return FRAME_RVA2;
+        case FrameID("UFID"): return FRAME_UFID;
+        case FrameID("USLT"): return FRAME_USLT;
+    }
+    switch (id >> 24) {
+        case 'T': return FRAME_TYYY;
+        case 'W': return FRAME_WYYY;
+        default:  return FRAME_NONE;
+    }
 }
 
-void ImportID3v2Frame(Object *object, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf) {
+ID3v2FrameKind FindID3v2FrameKind(const TagLib::ByteVector &id) {
+    return FindFrameKind(FrameID(id.data(), id.size()));
+}
+
+bool IsClearableID3v2Frame(const TagLib::ByteVector &id) {
+    return FRAME_HANDLERS[FindID3v2FrameKind(id)].clearable;
+}
+
+void ExportID3v2Frame(TagLib::ID3v2::Frame *frame, Result *object, const AttachmentSource &source, Configuration *conf) {
     TagLibWrapper o(object);
-    const TagLib::String idString = o.GetString("id");
-    const TagLib::ByteVector idVector(idString.toCString(), idString.length());
-    string id = idString.to8Bit(true);
-    if      (id.compare("TXXX") == 0) SetTXXX(o, tag, conf);
-    else if (id.at(0) == 'T')         SetTYYY(o, tag, idVector, conf);
-    else if (id.compare("WXXX") == 0) SetWXXX(o, tag, conf);
-    else if (id.at(0) == 'W')         SetWYYY(o, tag, idVector);
-    else if (id.compare("COMM") == 0) SetCOMM(o, tag, conf);
-    else if (id.compare("APIC") == 0) SetAPIC(o, tag, fmap, conf);
-    else if (id.compare("GEOB") == 0) SetGEOB(o, tag, fmap, conf);
-    else if (id.compare("POPM") == 0) SetPOPM(o, tag);
-    else if (id.compare("PRIV") == 0) SetPRIV(o, tag);
-    //else if (id.compare("RVA2") == 0) SetRVA2(o, tag, isolate, object);
-    else if (id.compare("UFID") == 0) SetUFID(o, tag, fmap, idVector);
-    else if (id.compare("USLT") == 0) SetUSLT(o, tag, idVector, conf);
-    else                              SetNONE(o, tag, idVector);
+    const TagLib::ByteVector &id = frame->frameID();
+    o.SetString("id", TagLib::String(id));
+    FRAME_HANDLERS[FindID3v2FrameKind(id)].get(o, frame, source, conf);
 }
 
+void LoadID3v2Attachment(TagLib::ID3v2::Frame *frame, const std::map<uintptr_t, std::string> &fmap, Configuration *conf) {
+    auto it = fmap.find((uintptr_t) frame);
+    if (it == fmap.end()) return;
+    if (auto f = dynamic_cast<TagLib::ID3v2::AttachedPictureFrame *>(frame)) {
+        f->setPicture(ImportByteVector(it->second, conf));
+    } else if (auto f = dynamic_cast<TagLib::ID3v2::GeneralEncapsulatedObjectFrame *>(frame)) {
+        f->setObject(ImportByteVector(it->second, conf));
+    } else if (auto f = dynamic_cast<TagLib::ID3v2::UniqueFileIdentifierFrame *>(frame)) {
+        f->setIdentifier(ImportByteVector(it->second, conf));
+    }
+}
@@ -3,14 +3,28 @@
 
 
 #include "configuration.h"
+#include "attachment.h"
 
-#include <nan.h>
+#include <map>
+#include <string>
 #include <taglib/id3v2tag.h>
 #include <taglib/id3v2frame.h>
 
 
-void ExportID3v2Frame(TagLib::ID3v2::Frame *frame, v8::Object *object, Configuration *conf);
+// Frames handled by own export and import, other text and URL frames share TYYY and WYYY.
+enum ID3v2FrameKind {
+    FRAME_TXXX, FRAME_TYYY, FRAME_WXXX, FRAME_WYYY, FRAME_COMM, FRAME_APIC, FRAME_GEOB,
+    FRAME_POPM, FRAME_PRIV, FRAME_RVA2, FRAME_UFID, FRAME_USLT, FRAME_NONE
+};
+
+ID3v2FrameKind FindID3v2FrameKind(const TagLib::ByteVector &id);
+
+bool IsClearableID3v2Frame(const TagLib::ByteVector &id);
+void ExportID3v2Frame(TagLib::ID3v2::Frame *frame, Result *object, const AttachmentSource &source, Configuration *conf);
 void ImportID3v2Frame(v8::Object *object, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf);
 
+// Reads attached data of imported APIC, GEOB or UFID frame given as file name (see fmap of ImportID3v2Frame).
+void LoadID3v2Attachment(TagLib::ID3v2::Frame *frame, const std::map<uintptr_t, std::string> &fmap, Configuration *conf);
+
 
 #endif //TAGIO_ID3V2FRAME_H
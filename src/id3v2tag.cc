@@ -1,58 +1,157 @@
 #include "id3v2tag.h"
 #include "id3v2frame.h"
+#include "bytevector.h"
 
-using namespace std;
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <sys/stat.h>
+#include <taglib/id3v2header.h>
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__))
+#include <unistd.h>
+#endif
 
-using v8::Local;
-using v8::Object;
-using v8::Array;
-using Nan::HandleScope;
-using Nan::New;
+using namespace std;
 
 void ClearID3v2Tag(TagLib::ID3v2::Tag *tag) {
-    typedef list<TagLib::ByteVector> ByteVectorList;
     TagLib::ID3v2::FrameList frameList = tag->frameList();
-    ByteVectorList list;
     for (uint32_t i = 0; i < frameList.size(); i++) {
         TagLib::ID3v2::Frame *frame = frameList[i];
-        TagLib::ByteVector vector = frame->frameID();
-        string id = string(vector.data(), vector.size());
-        if (id.at(0) == 'T' ||
-            id.at(0) == 'W' ||
-            id.compare("COMM") == 0 ||
-            id.compare("APIC") == 0 ||
-            id.compare("GEOB") == 0 ||
-            id.compare("POPM") == 0 ||
-            id.compare("PRIV") == 0 ||
-            id.compare("RVA2") == 0 ||
-            id.compare("UFID") == 0 ||
-            id.compare("USLT") == 0) {
-            list.push_back(vector);
-        }
+        if (IsClearableID3v2Frame(frame->frameID()))
+            tag->removeFrame(frame, true);
     }
-    for (ByteVectorList::const_iterator ci = list.begin(); ci != list.end(); ++ci)
-        tag->removeFrames(*ci);
-
-    list.clear();
 }
 
 
-void ExportID3v2Tag(TagLib::ID3v2::Tag *tag, v8::Array *frames, Configuration *conf) {
-    HandleScope scope;
+void ExportID3v2Tag(TagLib::ID3v2::Tag *tag, Result *frames, const std::string &path, Configuration *conf) {
+    const Projection &fields = conf->Fields();
+    AttachmentSource source;
+    if (conf->FileExtracted() == FILE_EXTRACTED_AS_HANDLE && (fields.HasFrame("APIC") || fields.HasFrame("GEOB")))
+        source.Locate(path, tag);
     TagLib::ID3v2::FrameList frameList = tag->frameList();
     for (unsigned int i = 0; i < frameList.size(); i++) {
         TagLib::ID3v2::Frame *frame = frameList[i];
-        Local<Object> object = New<Object>();
-        ExportID3v2Frame(frame, *object, conf);
-        frames->Set(i, object);
+        // skipped before the text is decoded or the attached file is written
+        if (!fields.HasFrame(frame->frameID())) continue;
+        ExportID3v2Frame(frame, frames->PushObject(), source, conf);
+    }
+}
+
+void MoveID3v2Frames(TagLib::ID3v2::Tag *from, TagLib::ID3v2::Tag *to, const std::map<uintptr_t, std::string> &fmap, Configuration *conf) {
+    TagLib::ID3v2::FrameList frames = from->frameList();
+    for (auto frame : frames) {
+        LoadID3v2Attachment(frame, fmap, conf);
+        from->removeFrame(frame, false);
+        to->addFrame(frame);
+    }
+}
+
+
+const uint32_t TAGLIB_PADDING = 1024;   // appended by ID3v2::Tag::render to tag which does not fit
+const size_t COPY_BLOCK_SIZE = 1024 * 1024;
+
+static uint32_t ParseSyncSafe(const unsigned char *p) {
+    return ((uint32_t) (p[0] & 0x7F) << 21) | ((uint32_t) (p[1] & 0x7F) << 14) |
+           ((uint32_t) (p[2] & 0x7F) << 7) | (uint32_t) (p[3] & 0x7F);
+}
+
+static void RenderHeader(unsigned char *p, uint32_t version, uint32_t tagSize) {
+    p[0] = 'I'; p[1] = 'D'; p[2] = '3';
+    p[3] = (unsigned char) version; p[4] = 0; p[5] = 0;
+    p[6] = (unsigned char) ((tagSize >> 21) & 0x7F);
+    p[7] = (unsigned char) ((tagSize >> 14) & 0x7F);
+    p[8] = (unsigned char) ((tagSize >> 7) & 0x7F);
+    p[9] = (unsigned char) (tagSize & 0x7F);
+}
+
+// Header, frames and zero padding.
+static bool WriteTag(FILE *f, uint32_t version, const char *frames, size_t size, uint32_t padding) {
+    unsigned char header[10];
+    RenderHeader(header, version, (uint32_t) size + padding);
+    if (fwrite(header, 1, 10, f) != 10 || fwrite(frames, 1, size, f) != size) return false;
+    std::vector<char> zeros(std::min<size_t>(padding, COPY_BLOCK_SIZE), 0);
+    for (size_t left = padding; left > 0; ) {
+        size_t n = std::min(left, zeros.size());
+        if (fwrite(zeros.data(), 1, n, f) != n) return false;
+        left -= n;
     }
+    return true;
 }
 
-void ImportID3v2Tag(v8::Array *frames, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf) {
-    ClearID3v2Tag(tag);
-    for (unsigned int i = 0; i < frames->Length(); i++) {
-        Local<Object> object = frames->Get(i)->ToObject();
-        ImportID3v2Frame(*object, tag, fmap, conf);
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__))
+// New tag followed by everything after the old tag, flushed to disk before rename.
+static bool RewriteFile(FILE *source, const std::string &path, uint64_t region, uint32_t version,
+                        const char *frames, size_t size, uint32_t padding) {
+    struct stat st;
+    if (fstat(fileno(source), &st) != 0 || fseek(source, (long) region, SEEK_SET) != 0) return false;
+    if (st.st_nlink > 1) return false; // rename would split the hard links - TagLib rewrites in place
+    std::string tempPath = TemporaryPath(path);
+    FILE *target = fopen(tempPath.c_str(), "wb");
+    if (target == nullptr) return false;
+    bool ok = WriteTag(target, version, frames, size, padding);
+    std::vector<char> block(COPY_BLOCK_SIZE);
+    while (ok) {
+        size_t n = fread(block.data(), 1, block.size(), source);
+        if (n > 0 && fwrite(block.data(), 1, n, target) != n) ok = false;
+        if (n < block.size()) {
+            ok = ok && !ferror(source);
+            break;
+        }
     }
+    ok = ok && fflush(target) == 0 && fsync(fileno(target)) == 0;
+    ok = (fclose(target) == 0) && ok;
+    ok = ok && chmod(tempPath.c_str(), st.st_mode & 07777) == 0;
+    ok = ok && rename(tempPath.c_str(), path.c_str()) == 0;
+    if (!ok) remove(tempPath.c_str());
+    return ok;
 }
+#endif
+
+bool SaveID3v2Tag(TagLib::ID3v2::Tag *tag, const std::string &path, bool found, Configuration *conf) {
+    TagLib::ID3v2::Header *header = tag->header();
+    const TagLib::uint originalSize = header->tagSize();
 
+    // with zero tag size render always appends its fixed padding - frames are the rest
+    header->setTagSize(0);
+    TagLib::ByteVector rendered = tag->render((int) conf->ID3v2Version());
+    header->setTagSize(originalSize);
+    if (rendered.size() <= 10 + TAGLIB_PADDING) return false;
+    const char *frames = rendered.data() + 10;
+    const size_t size = rendered.size() - 10 - TAGLIB_PADDING;
+    const uint32_t version = header->majorVersion();
+
+    FILE *f = fopen(path.c_str(), "r+b");
+    if (f == nullptr) return false;
+
+    // region of the old tag - header, frames, padding and footer
+    uint64_t region = 0;
+    unsigned char old[10];
+    if (fread(old, 1, 10, f) == 10 && old[0] == 'I' && old[1] == 'D' && old[2] == '3')
+        region = 10 + (uint64_t) ParseSyncSafe(old + 6) + ((old[5] & 0x10) ? 10 : 0);
+    else if (found) {
+        fclose(f); // tag found by TagLib further in the file
+        return false;
+    }
+
+    bool saved = false;
+    uint32_t padding = conf->ID3v2Padding();
+    if (region >= 10 + size) {
+        padding = (uint32_t) (region - 10 - size);
+        saved = fseek(f, 0, SEEK_SET) == 0 && WriteTag(f, version, frames, size, padding);
+        saved = (fflush(f) == 0) && saved;
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__))
+        saved = saved && fsync(fileno(f)) == 0;
+#endif
+        fclose(f);
+    } else {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+        fclose(f); // open file can not be replaced
+#else
+        saved = RewriteFile(f, path, region, version, frames, size, padding);
+        fclose(f);
+#endif
+    }
+    // response (and attachment handles) describe the tag as written
+    if (saved) header->setTagSize((TagLib::uint) (size + padding));
+    return saved;
+}
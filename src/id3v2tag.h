@@ -1,13 +1,25 @@
 #ifndef TAGIO_ID3V2TAG_H
 #define TAGIO_ID3V2TAG_H
 
-#include <nan.h>
 #include <taglib/id3v2tag.h>
 
 #include "configuration.h"
 
 void ClearID3v2Tag(TagLib::ID3v2::Tag *tag);
-void ExportID3v2Tag(TagLib::ID3v2::Tag *tag, v8::Array *frames, Configuration *conf);
+void ExportID3v2Tag(TagLib::ID3v2::Tag *tag, Result *frames, const std::string &path, Configuration *conf);
 void ImportID3v2Tag(v8::Array *frames, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf);
 
+// Moves imported frames to the file's tag - attachments given by file name are
+// read once, frames are not rendered and parsed again.
+void MoveID3v2Frames(TagLib::ID3v2::Tag *from, TagLib::ID3v2::Tag *to, const std::map<uintptr_t, std::string> &fmap, Configuration *conf);
+
+// Writes the tag to the start of the file - in place (synced before success)
+// when it fits the old tag and its padding, otherwise to a new file (with
+// id3v2Padding) renamed over the old one. The new file keeps only the mode of
+// the old one, owner, extended attributes and ACLs are not copied. False when
+// the caller has to save the tag by TagLib (the file has a tag elsewhere than at
+// its start, no frames, hard links, write failed, growing tag on Windows).
+// Tags at the end of the file must be saved and flushed before.
+bool SaveID3v2Tag(TagLib::ID3v2::Tag *tag, const std::string &path, bool found, Configuration *conf);
+
 #endif //TAGIO_ID3V2TAG_H
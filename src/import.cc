@@ -0,0 +1,630 @@
+// Imports - request objects read on the main thread into configuration, TagLib
+// tags and patches which the worker threads then write. Besides the requests
+// themselves, this and materialize.cc are the only translation units using V8.
+
+#include <nan.h>
+
+#include "wrapper.h"
+#include "keys.h"
+#include "configuration.h"
+#include "projection.h"
+#include "tag.h"
+#include "apetag.h"
+#include "id3v1tag.h"
+#include "id3v2tag.h"
+#include "id3v2frame.h"
+#include "xiphcomment.h"
+#include "flacpicture.h"
+#include "mp4item.h"
+#include "patch.h"
+#include "attachmentset.h"
+
+#include <map>
+#include <taglib/attachedpictureframe.h>
+#include <taglib/commentsframe.h>
+#include <taglib/generalencapsulatedobjectframe.h>
+#include <taglib/popularimeterframe.h>
+#include <taglib/privateframe.h>
+#include <taglib/relativevolumeframe.h>
+#include <taglib/textidentificationframe.h>
+#include <taglib/uniquefileidentifierframe.h>
+#include <taglib/unsynchronizedlyricsframe.h>
+#include <taglib/urllinkframe.h>
+
+using namespace v8;
+using namespace std;
+using Nan::New;
+
+TagLibWrapper::TagLibWrapper(Object *object) : object(object) {}
+
+bool TagLibWrapper::GetBoolean(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        return object->Get(keyString)->BooleanValue();
+    } else {
+        return false;
+    }
+}
+
+double TagLibWrapper::GetNumber(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        return object->Get(keyString)->NumberValue();
+    } else {
+        return 0.0;
+    }
+}
+
+int TagLibWrapper::GetInt32(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        return (int) (object->Get(keyString))->Int32Value();
+    } else {
+        return 0;
+    }
+}
+
+TagLib::uint TagLibWrapper::GetUint32(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        return (TagLib::uint) (object->Get(keyString))->Uint32Value();
+    } else {
+        return 0;
+    }
+}
+
+TagLib::String TagLibWrapper::GetString(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        String::Utf8Value value(object->Get(keyString));
+        return TagLib::String(*value, TagLib::String::UTF8);
+    } else {
+        return TagLib::String::null;
+    }
+}
+
+TagLib::StringList TagLibWrapper::GetStringList(const char *key) {
+    Local<String> keyString = Key(key);
+    Local<Array> array = Local<Array>::Cast(object->Get(keyString));
+    TagLib::StringList list;
+    //cout << "LENGTH" << array->Length() << endl;
+    if (object->Has(keyString)) {
+       for (uint32_t i = 0; i < array->Length(); i++) {
+           String::Utf8Value value(array->Get(i)->ToString());
+           TagLib::String string(*value, TagLib::String::UTF8);
+           list.append(string);
+       }
+    }
+    return list;
+}
+
+bool TagLibWrapper::IsBuffer(const char *key) {
+    Local<String> keyString = Key(key);
+    return object->Has(keyString) && node::Buffer::HasInstance(object->Get(keyString));
+}
+
+// Buffer content is copied - JS may modify or release the buffer after the call.
+TagLib::ByteVector TagLibWrapper::GetBuffer(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        Local<Value> buffer = object->Get(keyString);
+        return TagLib::ByteVector(node::Buffer::Data(buffer), (TagLib::uint) node::Buffer::Length(buffer));
+    } else {
+        return TagLib::ByteVector();
+    }
+}
+
+TagLib::String::Type TagLibWrapper::GetEncoding(const char *key) {
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        String::Utf8Value value(object->Get(keyString));
+        TagLib::String encodingString(*value, TagLib::String::UTF8);
+        if (encodingString == "Latin1") return TagLib::String::Latin1;
+        else if (encodingString == "UTF8") return TagLib::String::UTF8;
+        else if (encodingString == "UTF16") return TagLib::String::UTF16;
+        else if (encodingString == "UTF16BE") return TagLib::String::UTF16BE;
+        else if (encodingString == "UTF16LE") return TagLib::String::UTF16LE;
+        else return TagLib::String::UTF16;
+    } else {
+        return TagLib::String::UTF16;
+    }
+}
+
+TagLib::ByteVector TagLibWrapper::GetLanguage(const char *key) {
+    //TODO: Check valid ISO format
+    //TODO: Find better transoform from ByteVector to char *
+    Local<String> keyString = Key(key);
+    if (object->Has(keyString)) {
+        String::Utf8Value value(object->Get(keyString));
+        TagLib::String str(*value);
+        return TagLib::ByteVector(str.toCString(), str.size());
+    } else {
+        return TagLib::ByteVector();
+    }
+}
+
+static int FileExtractedAsCode(TagLib::String string) {
+    std::string s = string.to8Bit(true);
+    if (s.compare("IS_IGNORED") == 0)
+        return FILE_EXTRACTED_IS_IGNORED;
+    else if (s.compare("AS_FILENAME") == 0)
+        return FILE_EXTRACTED_AS_FILENAME;
+    else if (s.compare("AS_ABSOLUTE_URL") == 0)
+        return FILE_EXTRACTED_AS_ABSOLUTE_URL;
+    else if (s.compare("AS_RELATIVE_URL") == 0)
+        return FILE_EXTRACTED_AS_RELATIVE_URL;
+    else if (s.compare("AS_BUFFER") == 0)
+        return FILE_EXTRACTED_AS_BUFFER;
+    else if (s.compare("AS_HANDLE") == 0)
+        return FILE_EXTRACTED_AS_HANDLE;
+    else
+        return FILE_EXTRACTED_IS_IGNORED;
+}
+
+static int FileHashAsCode(TagLib::String string) {
+    std::string s = string.to8Bit(true);
+    if (s.compare("MD5") == 0)
+        return FILE_HASH_MD5;
+    else
+        return FILE_HASH_XXH3;
+}
+
+static int AudioPropertiesStyleAsCode(TagLib::String string) {
+    std::string s = string.to8Bit(true);
+    if (s.compare("FAST") == 0)
+        return AUDIO_PROPERTIES_FAST;
+    else if (s.compare("ACCURATE") == 0)
+        return AUDIO_PROPERTIES_ACCURATE;
+    else
+        return AUDIO_PROPERTIES_AVERAGE;
+}
+
+void ImportConfiguration(v8::Object *object, Configuration *conf) {
+    TagLibWrapper o(object);
+    conf->SetFileExtracted(FileExtractedAsCode(o.GetString("fileExtracted")));
+    conf->SetFileDirectory(o.GetString("fileDirectory"));
+    conf->SetFileHash(FileHashAsCode(o.GetString("fileHash")));
+    conf->SetFileUrlPrefix(o.GetString("fileUrlPrefix"));
+    conf->SetCacheDirectory(o.GetString("cacheDirectory"));
+    conf->SetImportCacheSize(o.GetUint32("importCacheSize"));
+    conf->SetConfigurationReadable(o.GetBoolean("configurationReadable"));
+    conf->SetAudioPropertiesReadable(o.GetBoolean("audioPropertiesReadable"));
+    conf->SetAudioPropertiesStyle(AudioPropertiesStyleAsCode(o.GetString("audioPropertiesStyle")));
+    conf->SetTagReadable(o.GetBoolean("tagReadable"));
+    conf->SetTimingsReadable(o.GetBoolean("timingsReadable"));
+    conf->SetAPEReadable(o.GetBoolean("apeReadable"));
+    conf->SetAPEWritable(o.GetBoolean("apeWritable"));
+    conf->SetID3v1Readable(o.GetBoolean("id3v1Readable"));
+    conf->SetID3v1Writable(o.GetBoolean("id3v1Writable"));
+    conf->SetID3v1Encoding(o.GetEncoding("id3v1Encoding"));
+    conf->SetID3v2Readable(o.GetBoolean("id3v2Readable"));
+    conf->SetID3v2Writable(o.GetBoolean("id3v2Writable"));
+    conf->SetID3v2Encoding(o.GetEncoding("id3v2Encoding"));
+    conf->SetID3v2Version(o.GetUint32("id3v2Version"));
+    conf->SetID3v2UseFrameEncoding(o.GetBoolean("id3v2UseFrameEncoding"));
+    conf->SetID3v2Padding(o.GetUint32("id3v2Padding"));
+    conf->SetXIPHCommentReadable(o.GetBoolean("xiphCommentReadable"));
+    conf->SetXIPHCommentWritable(o.GetBoolean("xiphCommentWritable"));
+    conf->SetXIPHCommentPadding(o.GetUint32("xiphCommentPadding"));
+    conf->SetMP4Readable(o.GetBoolean("mp4Readable"));
+    conf->SetMP4Writable(o.GetBoolean("mp4Writable"));
+    conf->SetThreads(o.GetUint32("threads"));
+    conf->SetQueueSize(o.GetUint32("queueSize"));
+    conf->SetQueueLimit(o.GetUint32("queueLimit"));
+}
+
+void ImportProjection(Array *array, Projection *projection) {
+    for (uint32_t i = 0; i < array->Length(); i++) {
+        String::Utf8Value field(array->Get(i));
+        if (*field != nullptr) projection->Add(string(*field));
+    }
+}
+
+void ImportTag(v8::Object *object, TagLib::Tag *tag) {
+    TagLibWrapper o(object);
+    tag->setTitle(o.GetString("title"));
+    tag->setAlbum(o.GetString("album"));
+    tag->setArtist(o.GetString("artist"));
+    tag->setTrack(o.GetUint32("track"));
+    tag->setYear(o.GetUint32("year"));
+    tag->setGenre(o.GetString("genre"));
+    tag->setComment(o.GetString("comment"));
+}
+
+void ImportTag(v8::Object *object, GenericTag *tag) {
+    TagLibWrapper o(object);
+    tag->title = o.GetString("title");
+    tag->album = o.GetString("album");
+    tag->artist = o.GetString("artist");
+    tag->track = o.GetUint32("track");
+    tag->year = o.GetUint32("year");
+    tag->genre = o.GetString("genre");
+    tag->comment= o.GetString("comment");
+}
+
+void ImportAPETag(v8::Object *object, TagLib::APE::Tag *tag) {
+    TagLibWrapper o(object);
+    tag->setTitle(o.GetString("title"));
+    tag->setAlbum(o.GetString("album"));
+    tag->setArtist(o.GetString("artist"));
+    tag->setTrack(o.GetUint32("track"));
+    tag->setYear(o.GetUint32("year"));
+    tag->setGenre(o.GetString("genre"));
+    tag->setComment(o.GetString("comment"));
+}
+
+class StringHandler : public TagLib::ID3v1::StringHandler {
+public:
+    StringHandler(TagLib::String::Type encoding) : encoding(encoding) { };
+    virtual TagLib::String parse(const TagLib::ByteVector &data) const;
+    virtual TagLib::ByteVector render(const TagLib::String &s) const;
+private:
+    TagLib::String::Type encoding;
+};
+
+TagLib::String StringHandler::parse(const TagLib::ByteVector &data) const {
+    TagLib::String s(data, encoding);
+    return s;
+}
+
+TagLib::ByteVector StringHandler::render(const TagLib::String &s) const {
+    TagLib::ByteVector v(s.data(encoding));
+    return v;
+}
+
+void ImportID3v1Tag(Object *object, TagLib::ID3v1::Tag *tag, Configuration *conf) {
+    tag->setStringHandler(new StringHandler(conf->ID3v1Encoding()));
+    TagLibWrapper o(object);
+    tag->setTitle(o.GetString("title"));
+    tag->setAlbum(o.GetString("album"));
+    tag->setArtist(o.GetString("artist"));
+    tag->setTrack(o.GetUint32("track"));
+    tag->setYear(o.GetUint32("year"));
+    tag->setGenre(o.GetString("genre"));
+    //tag->setGenreNumber(o.GetUint32("genreNumber"));
+    tag->setComment(o.GetString("comment"));
+}
+
+static map<TagLib::uint, TagLib::ID3v2::AttachedPictureFrame::Type> APIC = {
+    {0x00, TagLib::ID3v2::AttachedPictureFrame::Other},
+    {0x01, TagLib::ID3v2::AttachedPictureFrame::FileIcon},
+    {0x02, TagLib::ID3v2::AttachedPictureFrame::OtherFileIcon},
+    {0x03, TagLib::ID3v2::AttachedPictureFrame::FrontCover},
+    {0x04, TagLib::ID3v2::AttachedPictureFrame::BackCover},
+    {0x05, TagLib::ID3v2::AttachedPictureFrame::LeafletPage},
+    {0x06, TagLib::ID3v2::AttachedPictureFrame::Media},
+    {0x07, TagLib::ID3v2::AttachedPictureFrame::LeadArtist},
+    {0x08, TagLib::ID3v2::AttachedPictureFrame::Artist},
+    {0x09, TagLib::ID3v2::AttachedPictureFrame::Conductor},
+    {0x0A, TagLib::ID3v2::AttachedPictureFrame::Band},
+    {0x0B, TagLib::ID3v2::AttachedPictureFrame::Composer},
+    {0x0C, TagLib::ID3v2::AttachedPictureFrame::Lyricist},
+    {0x0D, TagLib::ID3v2::AttachedPictureFrame::RecordingLocation},
+    {0x0E, TagLib::ID3v2::AttachedPictureFrame::DuringRecording},
+    {0x0F, TagLib::ID3v2::AttachedPictureFrame::DuringPerformance},
+    {0x10, TagLib::ID3v2::AttachedPictureFrame::MovieScreenCapture},
+    {0x11, TagLib::ID3v2::AttachedPictureFrame::ColouredFish},
+    {0x12, TagLib::ID3v2::AttachedPictureFrame::Illustration},
+    {0x13, TagLib::ID3v2::AttachedPictureFrame::BandLogo},
+    {0x14, TagLib::ID3v2::AttachedPictureFrame::PublisherLogo}
+};
+
+static map<TagLib::uint, TagLib::ID3v2::RelativeVolumeFrame::ChannelType> RVA2 = {
+    {0x00, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::Other},
+    {0x01, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::MasterVolume},
+    {0x02, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::FrontRight},
+    {0x03, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::FrontLeft},
+    {0x04, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::BackRight},
+    {0x05, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::BackLeft},
+    {0x06, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::FrontCentre},
+    {0x07, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::BackCentre},
+    {0x08, TagLib::ID3v2::RelativeVolumeFrame::ChannelType::Subwoofer}
+};
+
+static inline void SetTXXX(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f= new TagLib::ID3v2::UserTextIdentificationFrame(TagLib::String::UTF8);
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setDescription(o.GetString("description"));
+    f->setText(o.GetString("text"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetTYYY(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f= new TagLib::ID3v2::TextIdentificationFrame(id, TagLib::String::UTF8);
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setText(o.GetString("text"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetWXXX(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::UserUrlLinkFrame();
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setTextEncoding(conf->ID3v2Encoding());
+    f->setDescription(o.GetString("description"));
+    f->setUrl(o.GetString("url"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetWYYY(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::UrlLinkFrame(id);
+    f->setUrl(o.GetString("url"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetCOMM(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::CommentsFrame();
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setTextEncoding(conf->ID3v2Encoding());
+    f->setText(o.GetString("text"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetAPIC(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    uint32_t type = o.GetUint32("type");
+    auto *f = new TagLib::ID3v2::AttachedPictureFrame();
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setTextEncoding(conf->ID3v2Encoding());
+    f->setMimeType(o.GetString("mimeType"));
+    if (APIC.count(type)) f->setType(APIC[type]);
+    else f->setType(TagLib::ID3v2::AttachedPictureFrame::Other);
+    f->setDescription(o.GetString("description"));
+    if (o.IsBuffer("picture")) f->setPicture(o.GetBuffer("picture"));
+    else (*fmap)[(uintptr_t) f] = o.GetString("picture").to8Bit(true);
+    tag->addFrame(f);
+}
+
+
+static inline void SetGEOB(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::GeneralEncapsulatedObjectFrame();
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setTextEncoding(conf->ID3v2Encoding());
+    f->setMimeType(o.GetString("mimeType"));
+    f->setFileName(o.GetString("fileName"));
+    f->setDescription(o.GetString("description"));
+    if (o.IsBuffer("object")) f->setObject(o.GetBuffer("object"));
+    else (*fmap)[(uintptr_t) f] = o.GetString("object").to8Bit(true);
+    tag->addFrame(f);
+}
+
+
+static inline void SetPOPM(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::PopularimeterFrame();
+    f->setEmail(o.GetString("email"));
+    f->setRating(o.GetInt32("rating")); // 0 - 255
+    f->setCounter(o.GetUint32("counter"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetPRIV(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::PrivateFrame();
+    f->setOwner(o.GetString("owner"));
+    tag->addFrame(f);
+}
+
+
+//static inline void SetRVA2(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, Isolate *isolate, Object *object) {
+//    //TODO: Test RVA2 usability
+//    Local<Array> channelArray = Local<Array>::Cast(object->Get(String::NewFromUtf8(isolate, "channels")));
+//    auto *f = new TagLib::ID3v2::RelativeVolumeFrame();
+//    for (unsigned int i = 0; i < channelArray->Length(); i++) {
+//        Local<Object> channelObject = channelArray->Get(i)->ToObject();
+//        TagLibWrapper co(isolate, *channelObject);
+//        TagLib::ID3v2::RelativeVolumeFrame::ChannelType channelType = RVA2[co.GetInt32("channelType")];
+//        float volumeAdjustment = (float) co.GetNumber("volumeAdjustment");
+//        TagLib::ID3v2::RelativeVolumeFrame::PeakVolume peakVolume;
+//        peakVolume.bitsRepresentingPeak = (unsigned char) co.GetString("bitsRepresentingPeak")[0];
+//        peakVolume.peakVolume = TagLib::ByteVector(co.GetString("peakVolume").toCString());
+//        f->setVolumeAdjustment(volumeAdjustment, channelType);
+//        f->setPeakVolume(peakVolume, channelType);
+//    }
+//    tag->addFrame(f);
+//}
+
+static inline void SetUFID(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    TagLib::String owner = o.GetString("owner");
+    auto *f = new TagLib::ID3v2::UniqueFileIdentifierFrame(owner, id);
+    if (o.IsBuffer("identifier")) f->setIdentifier(o.GetBuffer("identifier"));
+    else (*fmap)[(uintptr_t) f] = o.GetString("identifier").to8Bit(true);
+    tag->addFrame(f);
+}
+
+
+static inline void SetUSLT(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    auto *f = new TagLib::ID3v2::UnsynchronizedLyricsFrame(id);
+    TagLib::String languageString = o.GetString("language");
+    if (conf->ID3v2UseFrameEncoding()) f->setTextEncoding(o.GetEncoding("textEncoding"));
+    else f->setTextEncoding(conf->ID3v2Encoding());
+    f->setTextEncoding(conf->ID3v2Encoding());
+    f->setDescription(o.GetString("description"));
+    f->setLanguage(TagLib::ByteVector(languageString.toCString(false), languageString.size()));
+    f->setText(o.GetString("text"));
+    tag->addFrame(f);
+}
+
+
+static inline void SetNONE(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf) {
+    //auto *f = new TagLib::ID3v2::UnknownFrame(o.GetBytes("data"));
+    //tag->addFrame(f);
+}
+
+typedef void (*FrameSetter)(TagLibWrapper &o, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, const TagLib::ByteVector &id, Configuration *conf);
+
+// indexed by ID3v2FrameKind
+static const FrameSetter FRAME_SETTERS[] = {
+    SetTXXX,    // TXXX
+    SetTYYY,    // TYYY
+    SetWXXX,    // WXXX
+    SetWYYY,    // WYYY
+    SetCOMM,    // COMM
+    SetAPIC,    // APIC
+    SetGEOB,    // GEOB
+    SetPOPM,    // POPM
+    SetPRIV,    // PRIV
+    SetNONE,    // RVA2 //TODO: Reimplement GetRVA2/SetRVA2
+    SetUFID,    // UFID
+    SetUSLT,    // USLT
+    SetNONE     // NONE
+};
+
+void ImportID3v2Frame(Object *object, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf) {
+    TagLibWrapper o(object);
+    const TagLib::String idString = o.GetString("id");
+    const TagLib::ByteVector id(idString.toCString(), idString.length());
+    FRAME_SETTERS[FindID3v2FrameKind(id)](o, tag, fmap, id, conf);
+}
+
+void ImportID3v2Tag(v8::Array *frames, TagLib::ID3v2::Tag *tag, std::map<uintptr_t, std::string> *fmap, Configuration *conf) {
+    ClearID3v2Tag(tag);
+    for (unsigned int i = 0; i < frames->Length(); i++) {
+        Local<Object> object = frames->Get(i)->ToObject();
+        ImportID3v2Frame(*object, tag, fmap, conf);
+    }
+}
+
+void ImportXiphComment(v8::Array *array, TagLib::Ogg::XiphComment *tag) {
+    //tag->removeAllFields(); // in new version
+    ClearXiphComment(tag);
+    TagLib::Ogg::FieldListMap map = tag->fieldListMap();
+    map.clear();
+    for (unsigned int i = 0; i < array->Length(); i++) {
+        Local<Object> object = array->Get(i)->ToObject();
+        TagLibWrapper o(*object);
+        tag->addField(o.GetString("id"), o.GetString("text"));
+    }
+}
+
+void ImportFLACPictures(v8::Array *array, std::vector<TagLib::FLAC::Picture *> *pictures,
+                        std::map<uintptr_t, std::string> *fmap) {
+    for (unsigned int i = 0; i < array->Length(); i++) {
+        Local<Object> object = array->Get(i)->ToObject();
+        TagLibWrapper o(*object);
+        auto *picture = new TagLib::FLAC::Picture();
+        uint32_t type = o.GetUint32("type");
+        picture->setType(type <= TagLib::FLAC::Picture::PublisherLogo
+                         ? (TagLib::FLAC::Picture::Type) type : TagLib::FLAC::Picture::Other);
+        picture->setMimeType(o.GetString("mimeType"));
+        picture->setDescription(o.GetString("description"));
+        picture->setWidth(o.GetInt32("width"));
+        picture->setHeight(o.GetInt32("height"));
+        picture->setColorDepth(o.GetInt32("colorDepth"));
+        picture->setNumColors(o.GetInt32("numColors"));
+        if (o.IsBuffer("picture")) picture->setData(o.GetBuffer("picture"));
+        else (*fmap)[(uintptr_t) picture] = o.GetString("picture").to8Bit(true);
+        pictures->push_back(picture);
+    }
+}
+
+void MP4Items::Import(v8::Array *array) {
+    map<TagLib::String, TagLib::StringList> texts;
+    for (unsigned int i = 0; i < array->Length(); i++) {
+        Local<Object> object = array->Get(i)->ToObject();
+        TagLibWrapper o(*object);
+        const TagLib::String id = o.GetString("id");
+        if (id.isEmpty()) continue;
+        switch (FindMP4ItemKind(id)) {
+            case ITEM_INT_PAIR:
+                items.insert(id, TagLib::MP4::Item(o.GetInt32("number"), o.GetInt32("total")));
+                break;
+            case ITEM_BOOL:
+                items.insert(id, TagLib::MP4::Item(o.GetBoolean("value")));
+                break;
+            case ITEM_INT:
+                items.insert(id, TagLib::MP4::Item((int) o.GetNumber("value")));
+                break;
+            case ITEM_UINT:
+                items.insert(id, TagLib::MP4::Item((TagLib::uint) o.GetNumber("value")));
+                break;
+            case ITEM_BYTE:
+                items.insert(id, TagLib::MP4::Item((TagLib::uchar) o.GetNumber("value")));
+                break;
+            case ITEM_LONG_LONG:
+                items.insert(id, TagLib::MP4::Item((long long) o.GetNumber("value")));
+                break;
+            case ITEM_COVER: {
+                Cover cover;
+                cover.format = MP4CoverFormat(o.GetString("mimeType"));
+                if (o.IsBuffer("picture")) cover.data = o.GetBuffer("picture");
+                else cover.path = o.GetString("picture").to8Bit(true);
+                covers.push_back(cover);
+                break;
+            }
+            default:
+                texts[id].append(o.GetString("text"));
+                break;
+        }
+    }
+    for (auto const &text : texts) items.insert(text.first, TagLib::MP4::Item(text.second));
+}
+
+static int ImportOperation(const TagLib::String &op) {
+    if (op == "set") return PATCH_SET;
+    if (op == "remove") return PATCH_REMOVE;
+    if (op == "append") return PATCH_APPEND;
+    return 0;
+}
+
+void TagPatch::ImportID3v2(v8::Array *array, Configuration *conf) {
+    for (unsigned int i = 0; i < array->Length(); i++) {
+        Local<Object> object = array->Get(i)->ToObject();
+        TagLibWrapper o(*object);
+        FrameOperation operation;
+        operation.op = ImportOperation(o.GetString("op"));
+        operation.frame = nullptr;
+        if (operation.op == 0) continue;
+        const TagLib::String id = o.GetString("id");
+        operation.id = TagLib::ByteVector(id.toCString(), id.length());
+        if (operation.op == PATCH_REMOVE) {
+            operation.description = o.GetString("description");
+        } else {
+            size_t count = staging.frameList().size();
+            ImportID3v2Frame(*object, &staging, &fmap, conf);
+            if (staging.frameList().size() == count) continue;  // unsupported frame
+            operation.frame = staging.frameList().back();
+            operation.description = FrameDescription(operation.frame);
+        }
+        id3v2.push_back(operation);
+    }
+}
+
+void TagPatch::ImportXiphComment(v8::Array *array) {
+    for (unsigned int i = 0; i < array->Length(); i++) {
+        Local<Object> object = array->Get(i)->ToObject();
+        TagLibWrapper o(*object);
+        FieldOperation operation;
+        operation.op = ImportOperation(o.GetString("op"));
+        if (operation.op == 0) continue;
+        operation.key = o.GetString("id").upper();
+        operation.value = o.GetString("text");
+        xiph.push_back(operation);
+    }
+}
+
+void AttachmentSet::Import(v8::Object *object, Configuration *conf) {
+    Local<v8::String> id3v2Key = New<v8::String>("id3v2").ToLocalChecked();
+    Local<v8::String> picturesKey = New<v8::String>("pictures").ToLocalChecked();
+
+    if (conf->ID3v2Writable() && object->Has(id3v2Key)) {
+        Local<Array> id3v2Val = object->Get(id3v2Key).As<Array>();
+        for (unsigned int i = 0; i < id3v2Val->Length(); i++) {
+            Local<Object> frame = id3v2Val->Get(i)->ToObject();
+            ImportID3v2Frame(*frame, &staging, &fmap, conf);
+        }
+    }
+
+    if (conf->XIPHCommentWritable() && object->Has(picturesKey)) {
+        Local<Array> picturesVal = object->Get(picturesKey).As<Array>();
+        ImportFLACPictures(*picturesVal, &pictures, &fmap);
+    }
+}
@@ -0,0 +1,92 @@
+#include "keys.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::ObjectTemplate;
+using v8::String;
+using Nan::New;
+using Nan::Persistent;
+
+// Dynamic keys could grow the cache without limit - above it keys are created per call.
+const size_t MAX_CACHED_KEYS = 4096;
+
+// Fields in the order the Export* functions set them.
+static const char *const TAG_FIELDS[] = {
+    "title", "album", "artist", "track", "year", "genre", "comment", nullptr
+};
+
+static const char *const AUDIO_PROPERTIES_FIELDS[] = {
+    "length", "bitrate", "sampleRate", "channels", nullptr
+};
+
+static const char *const CONFIGURATION_FIELDS[] = {
+    "fileExtracted", "fileDirectory", "fileHash", "fileUrlPrefix", "cacheDirectory",
+    "importCacheSize", "configurationReadable", "audioPropertiesReadable", "audioPropertiesStyle",
+    "tagReadable", "timingsReadable",
+    "apeReadable", "apeWritable",
+    "id3v1Readable", "id3v1Writable", "id3v1Encoding",
+    "id3v2Readable", "id3v2Writable", "id3v2Version", "id3v2Encoding", "id3v2UseFrameEncoding",
+    "id3v2Padding",
+    "xiphCommentReadable", "xiphCommentWritable", "xiphCommentPadding",
+    "mp4Readable", "mp4Writable",
+    "threads", "queueSize", "queueLimit", nullptr
+};
+
+static const char *const *const SHAPE_FIELDS[SHAPE_COUNT] = {
+    TAG_FIELDS,                 // SHAPE_TAG - ExportTag
+    AUDIO_PROPERTIES_FIELDS,    // SHAPE_AUDIO_PROPERTIES - ExportAudioProperties
+    CONFIGURATION_FIELDS,       // SHAPE_CONFIGURATION - ExportConfiguration
+    TAG_FIELDS,                 // SHAPE_ID3V1 - ExportID3v1Tag
+    TAG_FIELDS                  // SHAPE_APE - ExportAPETag
+};
+
+// Handles are never reset, they live as long as the isolate does.
+// Destroying Nan::Persistent does not touch the isolate, so dropping
+// the cache after the isolate is gone is safe.
+struct KeyCache {
+    Isolate *isolate = nullptr;
+    unordered_map<string, unique_ptr<Persistent<String>>> keys;
+    unique_ptr<Persistent<ObjectTemplate>> templates[SHAPE_COUNT];
+};
+
+static thread_local KeyCache cache;
+
+static KeyCache &CurrentCache() {
+    Isolate *isolate = Isolate::GetCurrent();
+    if (cache.isolate != isolate) {
+        cache.keys.clear();
+        for (auto &tpl : cache.templates) tpl.reset();
+        cache.isolate = isolate;
+    }
+    return cache;
+}
+
+Local<String> Key(const char *key) {
+    KeyCache &c = CurrentCache();
+    auto it = c.keys.find(key);
+    if (it != c.keys.end()) return New(*it->second);
+
+    Local<String> value = String::NewFromUtf8(c.isolate, key, v8::NewStringType::kInternalized).ToLocalChecked();
+    if (c.keys.size() < MAX_CACHED_KEYS)
+        c.keys.emplace(key, unique_ptr<Persistent<String>>(new Persistent<String>(value)));
+    return value;
+}
+
+Local<Object> NewShapedObject(ObjectShape shape) {
+    KeyCache &c = CurrentCache();
+    if (!c.templates[shape]) {
+        Local<ObjectTemplate> tpl = New<ObjectTemplate>();
+        for (const char *const *field = SHAPE_FIELDS[shape]; *field != nullptr; field++)
+            tpl->Set(Key(*field), Nan::Undefined());
+        c.templates[shape].reset(new Persistent<ObjectTemplate>(tpl));
+    }
+    return Nan::NewInstance(New(*c.templates[shape])).ToLocalChecked();
+}
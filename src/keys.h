@@ -0,0 +1,19 @@
+#ifndef TAGIO_KEYS_H
+#define TAGIO_KEYS_H
+
+#include <nan.h>
+
+#include "result.h"
+
+// Per-isolate cache of property keys and object templates used to build results.
+// Must be called on the thread owning the isolate (main thread or a worker thread).
+
+// Internalized key string, created once per isolate.
+v8::Local<v8::String> Key(const char *key);
+
+// New object with all fields of the shape predeclared, so results of
+// one kind share the same hidden class and export only stores values.
+v8::Local<v8::Object> NewShapedObject(ObjectShape shape);
+
+
+#endif //TAGIO_KEYS_H
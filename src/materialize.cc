@@ -0,0 +1,71 @@
+#include "materialize.h"
+#include "keys.h"
+
+using v8::Local;
+using v8::Value;
+using v8::Object;
+using Nan::New;
+using Nan::Set;
+
+static void FreeByteVector(char *data, void *hint) {
+    delete static_cast<TagLib::ByteVector *>(hint);
+}
+
+Local<Value> Result::Materialize() const {
+    switch (type) {
+        case BOOLEAN:
+            return New<v8::Boolean>(boolean);
+        case NUMBER:
+            return New<v8::Number>(number);
+        case STRING:
+            return New<v8::String>(text.data(), (int) text.size()).ToLocalChecked();
+        case BUFFER: {
+            if (buffer.isEmpty()) return Nan::NewBuffer(0).ToLocalChecked();
+            // Buffer takes over the byte vector of the result. Non-const data() detaches
+            // (copies) the bytes when they are still shared with someone else, e.g. the
+            // import cache, so JS writes into the buffer never reach other copies.
+            TagLib::ByteVector *own = new TagLib::ByteVector(buffer);
+            buffer = TagLib::ByteVector();
+            char *data = own->data();
+            return Nan::NewBuffer(data, own->size(), FreeByteVector, own).ToLocalChecked();
+        }
+        case ARRAY: {
+            Local<v8::Array> array = New<v8::Array>((int) items.size());
+            for (uint32_t i = 0; i < items.size(); i++)
+                array->Set(i, items[i].Materialize());
+            return array;
+        }
+        case OBJECT: {
+            Local<v8::Object> object = shape == SHAPE_NONE ? New<v8::Object>() : NewShapedObject(shape);
+            for (size_t i = 0; i < items.size(); i++)
+                object->Set(Key(keys[i].c_str()), items[i].Materialize());
+            return object;
+        }
+        default:
+            return Nan::Undefined();
+    }
+}
+
+Local<Value> MaterializeTimed(Result &result, Timings &timings) {
+    if (!timings.Enabled()) return result.Materialize();
+
+    Local<Value> value;
+    {
+        TimingsScope scope(&timings, true);
+        PhaseTimer timer(PHASE_MATERIALIZE);
+        value = result.Materialize();
+    }
+    timings.Record();
+
+    Result object = Result::Object();
+    timings.Export(&object);
+    Set(value.As<Object>(), New<v8::String>("timings").ToLocalChecked(), object.Materialize());
+    return value;
+}
+
+NAN_METHOD(Stats) {
+    bool reset = info.Length() > 0 && info[0]->BooleanValue();
+    Result phases = Result::Object();
+    Timings::ExportStats(&phases, reset);
+    info.GetReturnValue().Set(phases.Materialize());
+}
@@ -0,0 +1,17 @@
+#ifndef TAGIO_MATERIALIZE_H
+#define TAGIO_MATERIALIZE_H
+
+#include <nan.h>
+
+#include "result.h"
+#include "timings.h"
+
+// Materializes the response of a worker. With timings enabled materialization is
+// measured, the timings are added to the response and recorded to stats.
+v8::Local<v8::Value> MaterializeTimed(Result &result, Timings &timings);
+
+// stats(reset) - per phase count, nanoseconds, bytes and histogram of all recorded requests
+NAN_METHOD(Stats);
+
+
+#endif //TAGIO_MATERIALIZE_H
@@ -334,3 +334,13 @@ std::string md5(const std::string str)
     return md5.hexdigest();
 }
 
+//////////////////////////////
+
+std::string md5(const char *data, size_t length)
+{
+    MD5 md5;
+    md5.update(data, (MD5::size_type) length);
+    md5.finalize();
+    
+    return md5.hexdigest();
+}
\ No newline at end of file
@@ -67,6 +67,7 @@ private:
 };
 
 std::string md5(const std::string str);
+std::string md5(const char *data, size_t length);
 
 
 #endif // TAGIO_MD5
\ No newline at end of file
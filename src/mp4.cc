@@ -0,0 +1,92 @@
+#include "mp4.h"
+#include "configuration.h"
+#include "cache.h"
+#include "audioproperties.h"
+#include "tag.h"
+#include "mp4item.h"
+#include "timings.h"
+
+#include "taglib/mp4file.h"
+
+using std::string;
+
+class MP4Reader : public Reader {
+public:
+    MP4Reader(const string &path, Configuration *conf) : Reader(path, conf) {}
+
+    // Takes ownership of already opened (and saved) file.
+    MP4Reader(const string &path, Configuration *conf, TagLib::MP4::File *file)
+            : Reader(path, conf), file(file) {}
+
+    ~MP4Reader() {
+        delete file;
+    }
+
+protected:
+    bool OpenFile() {
+        if (file == nullptr) file = new TagLib::MP4::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
+        audioProperties = file->audioProperties();
+        tag = file->tag();
+        return file->isValid();
+    }
+
+    void ExportTags(Result *result) {
+        const Projection &fields = conf->Fields();
+
+        if (conf->AudioPropertiesReadable() && audioProperties != nullptr) {
+            ExportAudioProperties(audioProperties, result->SetObject("audioProperties", SHAPE_AUDIO_PROPERTIES));
+        }
+
+        if (conf->TagReadable() && tag != nullptr) {
+            ExportTag(tag, result->SetObject("tag", fields.Shape(SHAPE_TAG)), fields);
+        }
+
+        if (conf->MP4Readable() && tag != nullptr) {
+            ExportMP4Items(tag, result->SetArray("mp4", tag->itemListMap().size()), path, conf);
+        }
+
+        if (conf->MP4Readable() && valid && fields.Has("chapters")) {
+            ExportMP4Chapters(path, result);
+        }
+    }
+
+private:
+    TagLib::MP4::File *file = nullptr;
+
+    // extracted
+    TagLib::MP4::Properties *audioProperties = nullptr;
+    TagLib::MP4::Tag *tag = nullptr;
+};
+
+Reader *NewMP4Reader(const string &path, Configuration *conf) {
+    return new MP4Reader(path, conf);
+}
+
+void WriteMP4File(const string &path, Configuration *conf, MP4Items *items, bool verify, Result *result) {
+    TagLib::MP4::File *file;
+    {
+        PhaseTimer timer(PHASE_OPEN);
+        file = new TagLib::MP4::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
+    }
+    if (file->isValid() && items != nullptr) {
+        items->Apply(file->tag(), conf);
+        // TagLib uses free atoms around ilst, moves the rest of the file
+        // and updates stco/co64 offsets only when they are not enough
+        PhaseTimer timer(PHASE_SAVE);
+        file->save();
+    }
+    InvalidateMetadataCache(path, conf);
+    // response is built from saved in-memory tags unless re-read is requested
+    if (verify) {
+        delete file;
+        file = nullptr;
+    }
+    // file is closed and the result fully converted before leaving the worker thread
+    MP4Reader reader(path, conf, file);
+    if (file == nullptr) {
+        reader.Read(result);
+    } else {
+        reader.Open();
+        reader.Export(result);
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef TAGIO_MP4_H
+#define TAGIO_MP4_H
+
+#include <string>
+
+#include "reader.h"
+#include "mp4item.h"
+
+// MP4 audio (.m4a, .m4b, .mp4) files.
+Reader *NewMP4Reader(const std::string &path, Configuration *conf);
+
+// Applies the imported items (none keeps them as they are) and exports the response
+// from the saved tag, re-read with verify (worker thread).
+void WriteMP4File(const std::string &path, Configuration *conf, MP4Items *items, bool verify, Result *result);
+
+
+#endif //TAGIO_MP4_H
@@ -0,0 +1,59 @@
+#include "mp4atom.h"
+
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+static uint32_t ReadUint32BE(const unsigned char *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static bool ReadAt(ifstream &ifs, uint64_t offset, unsigned char *buffer, size_t length) {
+    ifs.clear();
+    ifs.seekg((streamoff) offset);
+    ifs.read(reinterpret_cast<char *>(buffer), (streamsize) length);
+    return ifs.good();
+}
+
+bool ReadMP4Atom(ifstream &ifs, uint64_t offset, uint64_t limit, MP4Atom *atom) {
+    unsigned char header[16];
+    if (offset + 8 > limit || !ReadAt(ifs, offset, header, 8)) return false;
+    uint64_t size = ReadUint32BE(header);
+    atom->content = offset + 8;
+    if (size == 1) { // 64-bit size follows the name
+        if (offset + 16 > limit || !ReadAt(ifs, offset + 8, header + 8, 8)) return false;
+        size = ((uint64_t) ReadUint32BE(header + 8) << 32) | ReadUint32BE(header + 12);
+        atom->content = offset + 16;
+    } else if (size == 0) { // last atom of the file
+        size = limit - offset;
+    }
+    if (size < atom->content - offset || size > limit - offset) return false;
+    memcpy(atom->name, header + 4, 4);
+    atom->name[4] = 0;
+    atom->offset = offset;
+    atom->end = offset + size;
+    return true;
+}
+
+bool FindMP4Atom(ifstream &ifs, const char *path, MP4Atom *atom) {
+    ifs.clear();
+    ifs.seekg(0, ios::end);
+    uint64_t start = 0;
+    uint64_t end = (uint64_t) ifs.tellg();
+    const string names(path);
+    for (size_t pos = 0; pos <= names.size(); ) {
+        size_t slash = names.find('/', pos);
+        if (slash == string::npos) slash = names.size();
+        const string name = names.substr(pos, slash - pos);
+        bool found = false;
+        for (uint64_t offset = start; !found && ReadMP4Atom(ifs, offset, end, atom); offset = atom->end)
+            found = name == atom->name;
+        if (!found) return false;
+        if (name == "meta") atom->content += 4;
+        start = atom->content;
+        end = atom->end;
+        pos = slash + 1;
+    }
+    return start <= end;
+}
@@ -0,0 +1,23 @@
+#ifndef TAGIO_MP4_ATOM_H
+#define TAGIO_MP4_ATOM_H
+
+#include <fstream>
+#include <stdint.h>
+
+// Atom of MP4 file read directly from disk - only its header is read.
+struct MP4Atom {
+    char name[5];
+    uint64_t offset;    // atom header
+    uint64_t content;   // after the header (children of container atom)
+    uint64_t end;
+};
+
+// Atom header at offset, false when it does not fit before limit.
+bool ReadMP4Atom(std::ifstream &ifs, uint64_t offset, uint64_t limit, MP4Atom *atom);
+
+// First atom on the path of names separated by slash (e.g. "moov/udta/meta/ilst").
+// Children of meta follow its version and flags.
+bool FindMP4Atom(std::ifstream &ifs, const char *path, MP4Atom *atom);
+
+
+#endif //TAGIO_MP4_ATOM_H
@@ -0,0 +1,147 @@
+#include "mp4item.h"
+#include "mp4atom.h"
+#include "wrapper.h"
+#include "bytevector.h"
+#include "attachment.h"
+
+#include <map>
+
+using namespace std;
+
+const uint64_t CHAPTERS_LIMIT = 1 << 20;   // chpl holds at most 255 short titles
+
+MP4ItemKind FindMP4ItemKind(const TagLib::String &id) {
+    if (id == "trkn" || id == "disk") return ITEM_INT_PAIR;
+    if (id == "cpil" || id == "pgap" || id == "pcst" || id == "hdvd") return ITEM_BOOL;
+    if (id == "tmpo") return ITEM_INT;
+    if (id == "tvsn" || id == "tves" || id == "cnID" || id == "sfID" || id == "atID" || id == "geID") return ITEM_UINT;
+    if (id == "stik" || id == "rtng" || id == "akID") return ITEM_BYTE;
+    if (id == "plID") return ITEM_LONG_LONG;
+    if (id == "covr") return ITEM_COVER;
+    return ITEM_TEXT;
+}
+
+static TagLib::String CoverMimeType(TagLib::MP4::CoverArt::Format format) {
+    switch (format) {
+        case TagLib::MP4::CoverArt::JPEG: return "image/jpeg";
+        case TagLib::MP4::CoverArt::PNG: return "image/png";
+        case TagLib::MP4::CoverArt::BMP: return "image/bmp";
+        case TagLib::MP4::CoverArt::GIF: return "image/gif";
+        default: return "";
+    }
+}
+
+TagLib::MP4::CoverArt::Format MP4CoverFormat(const TagLib::String &mimeType) {
+    if (mimeType == "image/jpeg" || mimeType == "image/jpg") return TagLib::MP4::CoverArt::JPEG;
+    if (mimeType == "image/png") return TagLib::MP4::CoverArt::PNG;
+    if (mimeType == "image/bmp") return TagLib::MP4::CoverArt::BMP;
+    if (mimeType == "image/gif") return TagLib::MP4::CoverArt::GIF;
+    return TagLib::MP4::CoverArt::Unknown;
+}
+
+
+void ExportMP4Items(TagLib::MP4::Tag *tag, Result *array, const string &path, Configuration *conf) {
+    const Projection &fields = conf->Fields();
+    TagLib::MP4::ItemListMap &items = tag->itemListMap();
+
+    AttachmentSource source;
+    if (conf->FileExtracted() == FILE_EXTRACTED_AS_HANDLE && fields.Has("covr") && items.contains("covr"))
+        source.Locate(path, items["covr"].toCoverArtList());
+
+    for (auto it = items.begin(); it != items.end(); it++) {
+        const TagLib::String &id = it->first;
+        // skipped before the text is decoded or the picture is written
+        if (!fields.Has(id.to8Bit(true).c_str())) continue;
+        const TagLib::MP4::Item &item = it->second;
+        switch (FindMP4ItemKind(id)) {
+            case ITEM_INT_PAIR: {
+                TagLibWrapper o(array->PushObject());
+                o.SetString("id", id);
+                o.SetInt32("number", item.toIntPair().first);
+                o.SetInt32("total", item.toIntPair().second);
+                break;
+            }
+            case ITEM_BOOL: {
+                TagLibWrapper o(array->PushObject());
+                o.SetString("id", id);
+                o.SetBoolean("value", item.toBool());
+                break;
+            }
+            case ITEM_INT:
+            case ITEM_UINT:
+            case ITEM_BYTE:
+            case ITEM_LONG_LONG: {
+                TagLibWrapper o(array->PushObject());
+                o.SetString("id", id);
+                const MP4ItemKind kind = FindMP4ItemKind(id);
+                o.SetNumber("value", kind == ITEM_INT ? (double) item.toInt()
+                                     : kind == ITEM_UINT ? (double) item.toUInt()
+                                     : kind == ITEM_BYTE ? (double) item.toByte()
+                                     : (double) item.toLongLong());
+                break;
+            }
+            case ITEM_COVER: {
+                const TagLib::MP4::CoverArtList covers = item.toCoverArtList();
+                for (auto cover = covers.begin(); cover != covers.end(); cover++) {
+                    TagLibWrapper o(array->PushObject());
+                    const TagLib::String mimeType = CoverMimeType(cover->format());
+                    o.SetString("id", id);
+                    o.SetString("mimeType", mimeType);
+                    ExportByteVector(o, "picture", cover->data(), mimeType, conf, source.Find(*cover));
+                }
+                break;
+            }
+            default: {
+                // binary freeform items have no text
+                const TagLib::StringList values = item.toStringList();
+                for (auto value = values.begin(); value != values.end(); value++) {
+                    TagLibWrapper o(array->PushObject());
+                    o.SetString("id", id);
+                    o.SetString("text", *value);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void ExportMP4Chapters(const string &path, Result *result) {
+    ifstream ifs;
+    ifs.open(path, ios::in | ios::binary);
+    if (!ifs.is_open()) return;
+
+    MP4Atom chpl;
+    if (!FindMP4Atom(ifs, "moov/udta/chpl", &chpl) || chpl.end - chpl.content > CHAPTERS_LIMIT) return;
+    vector<unsigned char> data((size_t) (chpl.end - chpl.content));
+    ifs.clear();
+    ifs.seekg((streamoff) chpl.content);
+    ifs.read(reinterpret_cast<char *>(data.data()), (streamsize) data.size());
+    if (!ifs.good() || data.size() < 5) return;
+
+    // version, flags, (reserved in version 1), count, then start in 100 ns units and title
+    size_t i = data[0] == 0 ? 4 : 8;
+    if (i >= data.size()) return;
+    const unsigned int count = data[i++];
+    Result *chapters = result->SetArray("chapters", count);
+    for (unsigned int c = 0; c < count && i + 9 <= data.size(); c++) {
+        uint64_t start = 0;
+        for (int b = 0; b < 8; b++) start = (start << 8) | data[i++];
+        const size_t length = data[i++];
+        if (i + length > data.size()) break;
+        TagLibWrapper o(chapters->PushObject());
+        o.SetNumber("start", (double) start / 10000);
+        o.SetString("title", TagLib::String(string(reinterpret_cast<const char *>(&data[i]), length), TagLib::String::UTF8));
+        i += length;
+    }
+}
+
+
+void MP4Items::Apply(TagLib::MP4::Tag *tag, Configuration *conf) const {
+    TagLib::MP4::ItemListMap &target = tag->itemListMap();
+    target = items;
+    if (covers.empty()) return;
+    TagLib::MP4::CoverArtList list;
+    for (auto const &cover : covers)
+        list.append(TagLib::MP4::CoverArt(cover.format, cover.path.empty() ? cover.data : ImportByteVector(cover.path, conf)));
+    target.insert("covr", TagLib::MP4::Item(list));
+}
@@ -0,0 +1,55 @@
+#ifndef TAGIO_MP4_ITEM_H
+#define TAGIO_MP4_ITEM_H
+
+#include <string>
+#include <vector>
+#include <taglib/mp4tag.h>
+
+#include "configuration.h"
+#include "result.h"
+
+// Item types by atom name - as TagLib parses and renders them.
+enum MP4ItemKind {
+    ITEM_TEXT,
+    ITEM_INT_PAIR,
+    ITEM_BOOL,
+    ITEM_INT,
+    ITEM_UINT,
+    ITEM_BYTE,
+    ITEM_LONG_LONG,
+    ITEM_COVER
+};
+
+MP4ItemKind FindMP4ItemKind(const TagLib::String &id);
+TagLib::MP4::CoverArt::Format MP4CoverFormat(const TagLib::String &mimeType);
+
+// Items of ilst atom, one object per value:
+// { id, text } - text items and freeform "----:mean:name" items
+// { id, number, total } - trkn, disk
+// { id, value } - flags (cpil, pgap ...) and numbers (tmpo, stik ...)
+// { id: "covr", mimeType, picture } - picture goes through the attachment pipeline
+void ExportMP4Items(TagLib::MP4::Tag *tag, Result *array, const std::string &path, Configuration *conf);
+
+// Nero chapters (moov/udta/chpl) read from disk - start in milliseconds and title.
+void ExportMP4Chapters(const std::string &path, Result *result);
+
+// Items of write request. Pictures given by file name are read on the worker thread.
+class MP4Items {
+public:
+    void Import(v8::Array *array);
+
+    // Replaces all items of the tag.
+    void Apply(TagLib::MP4::Tag *tag, Configuration *conf) const;
+
+private:
+    struct Cover {
+        TagLib::MP4::CoverArt::Format format;
+        TagLib::ByteVector data;
+        std::string path;
+    };
+
+    TagLib::MP4::ItemListMap items;
+    std::vector<Cover> covers;
+};
+
+#endif //TAGIO_MP4_ITEM_H
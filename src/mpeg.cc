@@ -1,6 +1,7 @@
 #include <taglib/generalencapsulatedobjectframe.h>
 #include "mpeg.h"
 #include "configuration.h"
+#include "cache.h"
 #include "audioproperties.h"
 #include "bytevector.h"
 #include "tag.h"
@@ -8,6 +9,8 @@
 #include "id3v1tag.h"
 #include "id3v2tag.h"
 #include "apetag.h"
+#include "patch.h"
+#include "timings.h"
 
 #include "taglib/mpegfile.h"
 #include "taglib/id3v1tag.h"
@@ -17,135 +20,59 @@
 #include "taglib/uniquefileidentifierframe.h"
 
 
+
 using std::string;
 using std::map;
-using v8::Function;
-using v8::Local;
-using v8::Value;
-using v8::String;
-using v8::Object;
-using v8::Array;
-using Nan::AsyncQueueWorker;
-using Nan::AsyncWorker;
-using Nan::Callback;
-using Nan::HandleScope;
-using Nan::New;
-using Nan::Null;
-using Nan::To;
 
-class MPEGWorker : public AsyncWorker {
+class MPEGReader : public Reader {
 public:
-    MPEGWorker(Callback *callback, string *path, Configuration *conf)
-            : save(false),
-              AsyncWorker(callback),
-              path(path),
-              conf(conf) {}
+    MPEGReader(const string &path, Configuration *conf) : Reader(path, conf) {}
 
-    MPEGWorker(Callback *callback, string *path, Configuration *conf,
-               TagLib::ID3v1::Tag *id3v1Tag,
-               TagLib::ID3v2::Tag *id3v2Tag,
-               TagLib::APE::Tag *apeTag,
-               std::map<uintptr_t, std::string> *fmap)
-            : save(true),
-              AsyncWorker(callback),
-              path(path),
-              conf(conf),
-              id3v1Tag(id3v1Tag),
-              id3v2Tag(id3v2Tag),
-              apeTag(apeTag),
-              fmap(fmap) {}
+    // Takes ownership of already opened (and saved) file.
+    MPEGReader(const string &path, Configuration *conf, TagLib::MPEG::File *file)
+            : Reader(path, conf), file(file) {}
 
-    ~MPEGWorker() {
-        delete path;
-        delete conf;
+    ~MPEGReader() {
         delete file;
-        if (fmap != nullptr) {
-            //TODO: memory leak?
-            //fmap->clear();
-            //delete fmap;
-        }
     }
 
-    void Execute () {
-        file = new TagLib::MPEG::File(path->c_str());
-        if (save) {
-            if (conf->ID3v1Writable()) WriteID3v1();
-            if (conf->ID3v2Writable()) WriteID3v2();
-            if (conf->APEWritable()) WriteAPE();
-            SaveFile();
-            delete file;
-            delete id3v1Tag;
-            delete id3v2Tag;
-            delete apeTag;
-        }
-        file = new TagLib::MPEG::File(path->c_str());
+protected:
+    bool OpenFile() {
+        if (file == nullptr) file = new TagLib::MPEG::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
         audioProperties = file->audioProperties();
         tag = file->tag();
         id3v1Tag = file->hasID3v1Tag() ? file->ID3v1Tag(false) : nullptr;
         id3v2Tag = file->hasID3v2Tag() ? file->ID3v2Tag(false) : nullptr;
         apeTag = file->hasAPETag() ? file->APETag(false) : nullptr;
+        return file->isValid();
     }
 
-    void HandleOKCallback () {
-        //std::cout << conf->fileDirectory() << std::endl;
-        HandleScope scope;
-        Local<Object> result= New<Object>();
-
-        Local<String> pathKey = New<String>("path").ToLocalChecked();
-        Local<String> pathVal = New<String>(path->c_str()).ToLocalChecked();
-        result->Set(pathKey, pathVal);
+    void ExportTags(Result *result) {
+        const Projection &fields = conf->Fields();
 
-        if (conf->ConfigurationReadable()) {
-            Local<String> confKey = New<String>("configuration").ToLocalChecked();
-            Local<Object> confVal = New<Object>();
-            ExportConfiguration(conf, *confVal);
-            result->Set(confKey, confVal);
-        }
-
-        if (conf->AudioPropertiesReadable()) {
-            Local<String> audioPropertiesKey = New<String>("audioProperties").ToLocalChecked();
-            Local<Object> audioPropertiesVal = New<Object>();
-            ExportAudioProperties(audioProperties, *audioPropertiesVal);
-            result->Set(audioPropertiesKey, audioPropertiesVal);
+        if (conf->AudioPropertiesReadable() && audioProperties != nullptr) {
+            ExportAudioProperties(audioProperties, result->SetObject("audioProperties", SHAPE_AUDIO_PROPERTIES));
         }
 
         if (conf->TagReadable()) {
-            Local<String> tagKey = New<String>("tag").ToLocalChecked();
-            Local<Object> tagVal = New<Object>();
-            ExportTag(tag, *tagVal);
-            result->Set(tagKey, tagVal);
+            ExportTag(tag, result->SetObject("tag", fields.Shape(SHAPE_TAG)), fields);
         }
 
         if (conf->ID3v1Readable() && id3v1Tag != nullptr) {
-            Local<String> id3v1Key = New<String>("id3v1").ToLocalChecked();
-            Local<Object> id3v1Val = New<Object>();
-            ExportID3v1Tag(id3v1Tag, *id3v1Val);
-            result->Set(id3v1Key, id3v1Val);
+            ExportID3v1Tag(id3v1Tag, result->SetObject("id3v1", fields.Shape(SHAPE_ID3V1)), fields);
         }
 
         if (conf->ID3v2Readable() && id3v2Tag != nullptr) {
-            Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
-            Local<Array> id3v2Val = New<Array>(id3v2Tag->frameList().size());
-            ExportID3v2Tag(id3v2Tag, *id3v2Val, conf);
-            result->Set(id3v2Key, id3v2Val);
+            ExportID3v2Tag(id3v2Tag, result->SetArray("id3v2", id3v2Tag->frameList().size()), path, conf);
         }
 
         if (conf->APEReadable() && apeTag != nullptr) {
-            Local<String> apeKey = New<String>("ape").ToLocalChecked();
-            Local<Object> apeVal = New<Object>();
-            ExportAPETag(apeTag, *apeVal);
-            result->Set(apeKey, apeVal);
+            ExportAPETag(apeTag, result->SetObject("ape", fields.Shape(SHAPE_APE)), fields);
         }
-
-        Local<Value> argv[] = { Null(), result };
-        callback->Call(2, argv);
     }
 
 private:
-    bool save = false;
-    string *path;
-    Configuration *conf;
-    TagLib::MPEG::File *file;
+    TagLib::MPEG::File *file = nullptr;
 
     // extracted
     TagLib::MPEG::Properties *audioProperties;
@@ -153,15 +80,30 @@ private:
     TagLib::ID3v1::Tag *id3v1Tag;
     TagLib::ID3v2::Tag *id3v2Tag;
     TagLib::APE::Tag *apeTag;
-    std::map<uintptr_t, std::string> *fmap;
-
-    void WriteID3v1();
-    void WriteID3v2();
-    void WriteAPE();
-    void SaveFile();
 };
 
-inline void MPEGWorker::WriteID3v1() {
+Reader *NewMPEGReader(const string &path, Configuration *conf) {
+    return new MPEGReader(path, conf);
+}
+
+static TagLib::MPEG::File *OpenMPEGFile(const string &path, Configuration *conf) {
+    PhaseTimer timer(PHASE_OPEN);
+    return new TagLib::MPEG::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
+}
+
+// Saved file is exported from memory, null file (verify) is read again. The file is
+// closed and the result fully converted before leaving the worker thread.
+static void ExportMPEGFile(const string &path, Configuration *conf, TagLib::MPEG::File *file, Result *result) {
+    MPEGReader reader(path, conf, file);
+    if (file == nullptr) {
+        reader.Read(result);
+    } else {
+        reader.Open();
+        reader.Export(result);
+    }
+}
+
+static void WriteID3v1(TagLib::MPEG::File *file, TagLib::ID3v1::Tag *id3v1Tag) {
     TagLib::ID3v1::Tag *t1 = file->ID3v1Tag(true);
     t1->setArtist(id3v1Tag->artist());
     t1->setAlbum(id3v1Tag->album());
@@ -173,45 +115,35 @@ inline void MPEGWorker::WriteID3v1() {
     t1->setComment(id3v1Tag->comment());
 }
 
-inline void MPEGWorker::WriteID3v2() {
+static void WriteID3v2(TagLib::MPEG::File *file, TagLib::ID3v2::Tag *id3v2Tag, const map<uintptr_t, string> &fmap, Configuration *conf) {
     TagLib::ID3v2::Tag *t2 = file->ID3v2Tag(true);
-    TagLib::ID3v2::FrameList l2 = id3v2Tag->frameList();
-    TagLib::ID3v2::FrameFactory *factory = TagLib::ID3v2::FrameFactory::instance();
     ClearID3v2Tag(t2);
-    for (unsigned int i = 0; i < l2.size(); i++) {
-        TagLib::ID3v2::Frame *frame = l2[i];
-        if (auto f = dynamic_cast<TagLib::ID3v2::AttachedPictureFrame *>(frame)) {
-            uintptr_t addr = (uintptr_t) frame;
-            std::string path = (*fmap)[addr];
-            f->setPicture(ImportByteVector(path, conf));
-        }
-        if (auto f = dynamic_cast<TagLib::ID3v2::GeneralEncapsulatedObjectFrame *>(frame)) {
-            uintptr_t addr = (uintptr_t) frame;
-            std::string path = (*fmap)[addr];
-            f->setObject(ImportByteVector(path, conf));
-        }
-        if (auto f = dynamic_cast<TagLib::ID3v2::UniqueFileIdentifierFrame *>(frame)) {
-            uintptr_t addr = (uintptr_t) frame;
-            std::string path = (*fmap)[addr];
-            f->setIdentifier(ImportByteVector(path, conf));
-        }
-        //TODO: Slow but safe?
-        t2->addFrame(factory->createFrame(frame->render(), conf->ID3v2Version()));
-    }
+    MoveID3v2Frames(id3v2Tag, t2, fmap, conf);
 }
 
-inline void MPEGWorker::WriteAPE() {
+static void WriteAPE(TagLib::MPEG::File *file, TagLib::APE::Tag *apeTag) {
     TagLib::APE::Tag *t1 = file->APETag(true);
-    t1->setArtist(id3v1Tag->artist());
-    t1->setAlbum(id3v1Tag->album());
-    t1->setTrack(id3v1Tag->track());
-    t1->setTitle(id3v1Tag->title());
-    t1->setGenre(id3v1Tag->genre());
-    t1->setYear(id3v1Tag->year());
-    t1->setComment(id3v1Tag->comment());
+    t1->setArtist(apeTag->artist());
+    t1->setAlbum(apeTag->album());
+    t1->setTrack(apeTag->track());
+    t1->setTitle(apeTag->title());
+    t1->setGenre(apeTag->genre());
+    t1->setYear(apeTag->year());
+    t1->setComment(apeTag->comment());
+}
+
+// Tag without frames is stripped from the file - TagLib's save(ID3v2, false)
+// skips an empty tag and would leave the old one on disk.
+static void SaveMPEGID3v2Tag(TagLib::MPEG::File *file, TagLib::ID3v2::Tag *t2, const string &path, bool found, Configuration *conf) {
+    if (t2->frameList().isEmpty()) {
+        file->strip(TagLib::MPEG::File::ID3v2, false);
+        return;
+    }
+    if (!SaveID3v2Tag(t2, path, found, conf))
+        file->save(TagLib::MPEG::File::ID3v2, false, conf->ID3v2Version(), false);
 }
 
-inline void MPEGWorker::SaveFile() {
+static void SaveMPEGFile(TagLib::MPEG::File *file, const string &path, Configuration *conf) {
     int NoTags  = 0x0000;
     int ID3v1   = 0x0001;
     int ID3v2   = 0x0002;
@@ -226,68 +158,64 @@ inline void MPEGWorker::SaveFile() {
     bool stripOthers = true;
     uint32_t id3v2Version = conf->ID3v2Version();
     bool duplicateTags = true;
-    //bool result = file->save(tags, stripOthers, id3v2Version, duplicateTags);
-    file->save(tags, stripOthers, id3v2Version, duplicateTags);
-}
-
-
-
-NAN_METHOD(ReadMPEG) {
-    Local<Object> reqObj = info[0].As<Object>();
-    Callback *callback = new Callback(info[1].As<Function>());
-
-    Local<String> pathKey = New<String>("path").ToLocalChecked();
-    Local<String> pathObj = reqObj->Get(pathKey).As<String>();
-    String::Utf8Value pathVal(pathObj);
-    std::string *path = new std::string(*pathVal);
-
-    Local<String> confKey = New<String>("configuration").ToLocalChecked();
-    Local<Object> confVal = reqObj->Get(confKey).As<Object>();
-    Configuration *conf = new Configuration();
-    ImportConfiguration(*confVal, conf);
+    if (!(tags & ID3v2)) {
+        file->save(tags, stripOthers, id3v2Version, duplicateTags);
+        return;
+    }
 
-    AsyncQueueWorker(new MPEGWorker(callback, path, conf));
+    // Tags at the end of the file are saved by TagLib, ID3v2 at the start is
+    // written by SaveID3v2Tag without moving the audio data unless it grows.
+    // Stripping and duplication follow TagLib's save(tags, true, version, true).
+    bool found = file->hasID3v2Tag();
+    TagLib::ID3v2::Tag *t2 = file->ID3v2Tag(true);
+    if (duplicateTags && file->ID3v1Tag() && (tags & ID3v1))
+        TagLib::Tag::duplicate(file->ID3v1Tag(), t2, false);
+    if (stripOthers && file->hasID3v1Tag() && !(tags & ID3v1)) file->strip(ID3v1, false);
+    if (stripOthers && file->hasAPETag() && !(tags & APE)) file->strip(APE, false);
+    if (tags & (ID3v1 | APE)) file->save(tags & (ID3v1 | APE), false, id3v2Version, duplicateTags);
+    file->seek(0); // flush TagLib's writes before the file is written again
+
+    SaveMPEGID3v2Tag(file, t2, path, found, conf);
 }
 
-NAN_METHOD(WriteMPEG) {
-    Configuration *conf = new Configuration();
-    TagLib::ID3v1::Tag *id3v1Tag = new TagLib::ID3v1::Tag();
-    TagLib::ID3v2::Tag *id3v2Tag = new TagLib::ID3v2::Tag();
-    TagLib::APE::Tag *apeTag = new TagLib::APE::Tag();
-    std::map<uintptr_t, std::string> *fmap = new std::map<uintptr_t, std::string>();
-
-    Local<Object> reqObj = info[0].As<Object>();
-    Callback *callback = new Callback(info[1].As<Function>());
-
-    Local<String> pathKey = New<String>("path").ToLocalChecked();
-    Local<String> confKey = New<String>("configuration").ToLocalChecked();
-    Local<String> id3v1Key = New<String>("id3v1").ToLocalChecked();
-    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
-    Local<String> apeKey = New<String>("ape").ToLocalChecked();
-
-    Local<String> pathObj = reqObj->Get(pathKey).As<String>();
-    String::Utf8Value pathVal(pathObj);
-    std::string *path = new std::string(*pathVal);
-
-    if (reqObj->Has(confKey)) {
-        Local<Object> confVal = reqObj->Get(confKey).As<Object>();
-        ImportConfiguration(*confVal, conf);
+void WriteMPEGFile(const string &path, Configuration *conf, TagLib::ID3v1::Tag *id3v1Tag, TagLib::ID3v2::Tag *id3v2Tag,
+                   TagLib::APE::Tag *apeTag, const map<uintptr_t, string> &fmap, bool verify, Result *result) {
+    TagLib::MPEG::File *file = OpenMPEGFile(path, conf);
+    if (conf->ID3v1Writable()) WriteID3v1(file, id3v1Tag);
+    if (conf->ID3v2Writable()) WriteID3v2(file, id3v2Tag, fmap, conf);
+    if (conf->APEWritable()) WriteAPE(file, apeTag);
+    {
+        PhaseTimer timer(PHASE_SAVE);
+        SaveMPEGFile(file, path, conf);
     }
-
-    if (conf->ID3v1Writable() && reqObj->Has(id3v1Key)) {
-        Local<Object> id3v1Val = reqObj->Get(id3v1Key).As<Object>();
-        ImportID3v1Tag(*id3v1Val, id3v1Tag, conf);
+    InvalidateMetadataCache(path, conf);
+    // response is built from saved in-memory tags unless re-read is requested
+    if (verify) {
+        delete file;
+        file = nullptr;
     }
+    ExportMPEGFile(path, conf, file, result);
+}
 
-    if (conf->ID3v2Writable() && reqObj->Has(id3v2Key)) {
-        Local<Array> id3v2Val = reqObj->Get(id3v2Key).As<Array>();
-        ImportID3v2Tag(*id3v2Val, id3v2Tag, fmap, conf);
-    }
+// Only the ID3v2 tag is saved and only when the patch changed it.
+static bool PatchMPEGTags(TagLib::MPEG::File *file, const string &path, TagPatch *patch, Configuration *conf) {
+    if (!patch->HasID3v2() || !file->isValid()) return false;
+    bool found = file->hasID3v2Tag();
+    TagLib::ID3v2::Tag *t2 = file->ID3v2Tag(true);
+    if (!patch->Apply(t2, conf)) return false;
+    PhaseTimer timer(PHASE_SAVE);
+    SaveMPEGID3v2Tag(file, t2, path, found, conf);
+    return true;
+}
 
-    if (conf->APEWritable() && reqObj->Has(apeKey)) {
-        Local<Object> apeVal = reqObj->Get(apeKey).As<Object>();
-        ImportAPETag(*apeVal, apeTag);
+void PatchMPEGFile(const string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result) {
+    TagLib::MPEG::File *file = OpenMPEGFile(path, conf);
+    bool changed = PatchMPEGTags(file, path, patch, conf);
+    if (changed) InvalidateMetadataCache(path, conf);
+    if (changed && verify) {
+        delete file;
+        file = nullptr;
     }
-
-    AsyncQueueWorker(new MPEGWorker(callback, path, conf, id3v1Tag, id3v2Tag, apeTag, fmap));
+    ExportMPEGFile(path, conf, file, result);
+    result->SetBoolean("changed", changed);
 }
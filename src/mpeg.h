@@ -1,9 +1,23 @@
 #ifndef TAGIO_MPEG_H
 #define TAGIO_MPEG_H
 
-#include <nan.h>
+#include <map>
+#include <string>
+#include <taglib/id3v1tag.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/apetag.h>
 
-NAN_METHOD(ReadMPEG);
-NAN_METHOD(WriteMPEG);
+#include "reader.h"
+#include "patch.h"
+
+Reader *NewMPEGReader(const std::string &path, Configuration *conf);
+
+// Replaces the writable tags of the file by the imported ones (ID3v2 frames are
+// moved) and exports the response from the saved tags, re-read with verify (worker thread).
+void WriteMPEGFile(const std::string &path, Configuration *conf, TagLib::ID3v1::Tag *id3v1Tag, TagLib::ID3v2::Tag *id3v2Tag,
+                   TagLib::APE::Tag *apeTag, const std::map<uintptr_t, std::string> &fmap, bool verify, Result *result);
+
+// Patches the file and exports the response with "changed" (worker thread).
+void PatchMPEGFile(const std::string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result);
 
 #endif //TAGIO_MPEG_H
@@ -0,0 +1,271 @@
+#include "ogg.h"
+#include "configuration.h"
+#include "cache.h"
+#include "audioproperties.h"
+#include "tag.h"
+#include "xiphcomment.h"
+#include "patch.h"
+#include "timings.h"
+
+#include <vector>
+#include "taglib/vorbisfile.h"
+#include "taglib/opusfile.h"
+
+using std::string;
+
+static const unsigned int PAGE_HEADER_SIZE = 27;
+
+// Opus by extension, .ogg holding Opus instead of Vorbis is opened as Opus too.
+static TagLib::Ogg::File *OpenOggFile(const string &path, Configuration *conf) {
+    const bool opus = FileExtension(path) == ".opus";
+    if (!opus) {
+        TagLib::Ogg::File *file = new TagLib::Ogg::Vorbis::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
+        if (file->isValid()) return file;
+        delete file;
+    }
+    return new TagLib::Ogg::Opus::File(path.c_str(), conf->AudioPropertiesReadable(), conf->AudioPropertiesReadStyle());
+}
+
+static TagLib::Ogg::XiphComment *OggComment(TagLib::Ogg::File *file) {
+    return dynamic_cast<TagLib::Ogg::XiphComment *>(file->tag());
+}
+
+// CRC-32 of Ogg page - polynomial 0x04c11db7, not reflected, no initial or final xor.
+static uint32_t PageChecksum(const TagLib::ByteVector &page) {
+    struct Table {
+        uint32_t values[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t r = i << 24;
+                for (int j = 0; j < 8; j++)
+                    r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+                values[i] = r;
+            }
+        }
+    };
+    static const Table table;
+    uint32_t crc = 0;
+    for (unsigned int i = 0; i < page.size(); i++)
+        crc = (crc << 8) ^ table.values[((crc >> 24) ^ (unsigned char) page[i]) & 0xff];
+    return crc;
+}
+
+// Page holding part of the comment header packet.
+struct CommentPage {
+    long offset;
+    TagLib::ByteVector header;  // fixed header and segment table
+    TagLib::ByteVector body;
+    unsigned int start;         // part of the comment packet in the body
+    unsigned int length;
+};
+
+// Pages of the second packet (comment header) of the first logical stream.
+static bool FindCommentPages(TagLib::File *file, std::vector<CommentPage> *pages) {
+    const long size = file->length();
+    long offset = 0;
+    uint32_t serial = 0;
+    unsigned int packet = 0;
+    while (offset + (long) PAGE_HEADER_SIZE <= size) {
+        CommentPage page;
+        page.offset = offset;
+        page.start = 0;
+        page.length = 0;
+        file->seek(offset);
+        page.header = file->readBlock(PAGE_HEADER_SIZE);
+        if (page.header.size() != PAGE_HEADER_SIZE || !page.header.startsWith("OggS")) return false;
+        const unsigned int segments = (unsigned char) page.header[26];
+        const TagLib::ByteVector lacing = file->readBlock(segments);
+        if (lacing.size() != segments) return false;
+        page.header.append(lacing);
+
+        unsigned int bodySize = 0;
+        for (unsigned int i = 0; i < segments; i++) bodySize += (unsigned char) lacing[i];
+        offset += page.header.size() + bodySize;
+
+        const uint32_t pageSerial = page.header.toUInt(14, 4, false);
+        if (page.offset == 0) serial = pageSerial;
+        if (pageSerial != serial) continue;    // page of another multiplexed stream
+
+        // lacing value below 255 ends a packet
+        bool contains = false;
+        bool complete = false;
+        unsigned int position = 0;
+        for (unsigned int i = 0; i < segments && !complete; i++) {
+            const unsigned int value = (unsigned char) lacing[i];
+            if (packet == 1) {
+                if (!contains) page.start = position;
+                contains = true;
+                page.length += value;
+            }
+            position += value;
+            if (value < 255) complete = ++packet == 2;
+        }
+        if (contains) {
+            page.body = file->readBlock(bodySize);
+            if (page.body.size() != bodySize) return false;
+            pages->push_back(page);
+        }
+        if (complete) return true;
+    }
+    return false;
+}
+
+// Comment packet zero padded to the length of the old one replaces it - page
+// layout stays the same, only the bodies and checksums of its pages change.
+static bool RewriteCommentPages(TagLib::Ogg::File *file, const TagLib::ByteVector &packet) {
+    std::vector<CommentPage> pages;
+    if (file->readOnly() || !FindCommentPages(file, &pages)) return false;
+    unsigned int length = 0;
+    for (auto const &page : pages) length += page.length;
+    if (packet.size() > length) return false;
+
+    TagLib::ByteVector padded(packet);
+    padded.resize(length, '\0');
+    unsigned int position = 0;
+    for (auto &page : pages) {
+        TagLib::ByteVector data(page.header);
+        data.append(page.body.mid(0, page.start));
+        data.append(padded.mid(position, page.length));
+        data.append(page.body.mid(page.start + page.length));
+        position += page.length;
+
+        for (int i = 22; i < 26; i++) data[i] = 0;
+        const uint32_t crc = PageChecksum(data);
+        for (int i = 0; i < 4; i++) data[22 + i] = (char) ((crc >> (8 * i)) & 0xff);
+
+        file->seek(page.offset);
+        file->writeBlock(data);
+    }
+    return true;
+}
+
+// Vorbis comment header is written in place when it fits the old one (and its
+// padding), otherwise TagLib writes it with xiphCommentPadding - all pages after
+// the comment are rewritten then. Padding follows the framing bit of Vorbis and
+// the comment list of Opus, where decoders ignore it.
+static bool SaveOggComment(TagLib::Ogg::File *file, TagLib::Ogg::XiphComment *comment, Configuration *conf) {
+    const bool opus = dynamic_cast<TagLib::Ogg::Opus::File *>(file) != nullptr;
+    TagLib::ByteVector packet = opus ? TagLib::ByteVector("OpusTags", 8) : TagLib::ByteVector("\x03vorbis", 7);
+    packet.append(comment->render(!opus));
+    if (RewriteCommentPages(file, packet)) return true;
+
+    packet.resize(packet.size() + conf->XIPHCommentPadding(), '\0');
+    file->setPacket(1, packet);
+    // Vorbis and Opus save would render the comment again without the padding
+    return file->TagLib::Ogg::File::save();
+}
+
+class OggReader : public Reader {
+public:
+    OggReader(const string &path, Configuration *conf) : Reader(path, conf) {}
+
+    // Takes ownership of already opened (and saved) file.
+    OggReader(const string &path, Configuration *conf, TagLib::Ogg::File *file)
+            : Reader(path, conf), file(file) {}
+
+    ~OggReader() {
+        delete file;
+    }
+
+protected:
+    bool OpenFile() {
+        if (file == nullptr) file = OpenOggFile(path, conf);
+        audioProperties = file->audioProperties();
+        tag = file->tag();
+        xiphComment = OggComment(file);
+        return file->isValid();
+    }
+
+    void ExportTags(Result *result) {
+        const Projection &fields = conf->Fields();
+
+        if (conf->AudioPropertiesReadable() && audioProperties != nullptr) {
+            ExportAudioProperties(audioProperties, result->SetObject("audioProperties", SHAPE_AUDIO_PROPERTIES));
+        }
+
+        if (conf->TagReadable() && tag != nullptr) {
+            ExportTag(tag, result->SetObject("tag", fields.Shape(SHAPE_TAG)), fields);
+        }
+
+        if (conf->XIPHCommentReadable() && xiphComment != nullptr) {
+            ExportXiphComment(xiphComment, result->SetArray("xiphComment", xiphComment->fieldCount()), fields);
+        }
+    }
+
+private:
+    TagLib::Ogg::File *file = nullptr;
+
+    // extracted
+    TagLib::AudioProperties *audioProperties = nullptr;
+    TagLib::Tag *tag = nullptr;
+    TagLib::Ogg::XiphComment *xiphComment = nullptr;
+};
+
+Reader *NewOggReader(const string &path, Configuration *conf) {
+    return new OggReader(path, conf);
+}
+
+static TagLib::Ogg::File *OpenTimed(const string &path, Configuration *conf) {
+    PhaseTimer timer(PHASE_OPEN);
+    return OpenOggFile(path, conf);
+}
+
+// Saved file is exported from memory, null file (verify) is read again. The file is
+// closed and the result fully converted before leaving the worker thread.
+static void ExportOggFile(const string &path, Configuration *conf, TagLib::Ogg::File *file, Result *result) {
+    OggReader reader(path, conf, file);
+    if (file == nullptr) {
+        reader.Read(result);
+    } else {
+        reader.Open();
+        reader.Export(result);
+    }
+}
+
+static void WriteXIPHComment(TagLib::Ogg::XiphComment *t, TagLib::Ogg::XiphComment *xiphComment) {
+    ClearXiphComment(t);
+    const TagLib::Ogg::FieldListMap map = xiphComment->fieldListMap();
+    for (auto const &ent1 : map) {
+        for (auto const &ent2 : ent1.second) {
+            t->addField(ent1.first, ent2, false);
+        }
+    }
+}
+
+void WriteOggFile(const string &path, Configuration *conf, TagLib::Ogg::XiphComment *xiphComment, bool verify,
+                  Result *result) {
+    TagLib::Ogg::File *file = OpenTimed(path, conf);
+    if (file->isValid() && conf->XIPHCommentWritable()) {
+        WriteXIPHComment(OggComment(file), xiphComment);
+        PhaseTimer timer(PHASE_SAVE);
+        SaveOggComment(file, OggComment(file), conf);
+    }
+    InvalidateMetadataCache(path, conf);
+    // response is built from saved in-memory comment unless re-read is requested
+    if (verify) {
+        delete file;
+        file = nullptr;
+    }
+    ExportOggFile(path, conf, file, result);
+}
+
+// File is saved only when the patch changed its comment.
+static bool PatchOggComment(TagLib::Ogg::File *file, TagPatch *patch, Configuration *conf) {
+    if (!file->isValid() || !patch->HasXiphComment()) return false;
+    if (!patch->Apply(OggComment(file))) return false;
+    PhaseTimer timer(PHASE_SAVE);
+    SaveOggComment(file, OggComment(file), conf);
+    return true;
+}
+
+void PatchOggFile(const string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result) {
+    TagLib::Ogg::File *file = OpenTimed(path, conf);
+    bool changed = PatchOggComment(file, patch, conf);
+    if (changed) InvalidateMetadataCache(path, conf);
+    if (changed && verify) {
+        delete file;
+        file = nullptr;
+    }
+    ExportOggFile(path, conf, file, result);
+    result->SetBoolean("changed", changed);
+}
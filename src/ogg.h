@@ -0,0 +1,22 @@
+#ifndef TAGIO_OGG_H
+#define TAGIO_OGG_H
+
+#include <string>
+#include <taglib/xiphcomment.h>
+
+#include "reader.h"
+#include "patch.h"
+
+// Ogg Vorbis (.ogg) and Opus (.opus) files.
+Reader *NewOggReader(const std::string &path, Configuration *conf);
+
+// Replaces the comment of the file by the imported one and exports the response
+// from the saved comment, re-read with verify (worker thread).
+void WriteOggFile(const std::string &path, Configuration *conf, TagLib::Ogg::XiphComment *xiphComment, bool verify,
+                  Result *result);
+
+// Patches the file and exports the response with "changed" (worker thread).
+void PatchOggFile(const std::string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result);
+
+
+#endif //TAGIO_OGG_H
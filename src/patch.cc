@@ -0,0 +1,190 @@
+#include "patch.h"
+#include "wrapper.h"
+#include "id3v2frame.h"
+#include "attachment.h"
+#include "result.h"
+
+#include <algorithm>
+#include <taglib/textidentificationframe.h>
+#include <taglib/urllinkframe.h>
+
+
+// Description identifying user defined frames, null for the other frames.
+TagLib::String TagPatch::FrameDescription(TagLib::ID3v2::Frame *frame) {
+    if (auto f = dynamic_cast<TagLib::ID3v2::UserTextIdentificationFrame *>(frame)) return f->description();
+    if (auto f = dynamic_cast<TagLib::ID3v2::UserUrlLinkFrame *>(frame)) return f->description();
+    return TagLib::String::null;
+}
+
+static bool IsDescribed(const TagLib::ByteVector &id) {
+    return id == "TXXX" || id == "WXXX";
+}
+
+// Frames are equal when they export the same - attached data is compared
+// in memory and the text encoding only when the frame encoding is exported.
+static std::string FrameContent(TagLib::ID3v2::Frame *frame, Configuration *conf) {
+    Configuration compare;
+    compare.SetFileExtracted(FILE_EXTRACTED_AS_BUFFER);
+    compare.SetID3v2UseFrameEncoding(conf->ID3v2UseFrameEncoding());
+    Result object = Result::Object();
+    ExportID3v2Frame(frame, &object, AttachmentSource(), &compare);
+    std::string content;
+    object.Serialize(content);
+    return content;
+}
+
+
+static bool SamePicture(const TagLib::FLAC::Picture *a, const TagLib::FLAC::Picture *b) {
+    return a->type() == b->type() && a->mimeType() == b->mimeType() && a->description() == b->description()
+           && a->width() == b->width() && a->height() == b->height() && a->colorDepth() == b->colorDepth()
+           && a->numColors() == b->numColors() && a->data() == b->data();
+}
+
+
+TagPatch::~TagPatch() {
+    for (auto picture : pictures) delete picture;
+}
+
+void TagPatch::AddSharedID3v2(TagLib::ID3v2::Frame *frame) {
+    staging.addFrame(frame);
+    FrameOperation operation;
+    operation.op = PATCH_SET;
+    operation.id = frame->frameID();
+    operation.description = FrameDescription(frame);
+    operation.frame = frame;
+    shared.push_back(operation);
+}
+
+void TagPatch::SetPictures(const std::vector<TagLib::FLAC::Picture *> &list) {
+    for (auto picture : pictures) delete picture;
+    pictures = list;
+}
+
+void TagPatch::Move(TagLib::ID3v2::Frame *frame, TagLib::ID3v2::Tag *tag) {
+    staging.removeFrame(frame, false);
+    tag->addFrame(frame);
+}
+
+// Shared frame of an ID (and description) which the file sets or removes itself.
+bool TagPatch::Overridden(const FrameOperation &operation) const {
+    for (auto const &own : id3v2) {
+        if (own.op == PATCH_APPEND || own.id != operation.id) continue;
+        if (!IsDescribed(own.id) || own.description.isNull() || own.description == operation.description)
+            return true;
+    }
+    return false;
+}
+
+// Frames of each shared ID are replaced by all shared frames of the ID at once,
+// so several APIC (GEOB, PRIV ...) frames survive together. The ID is left alone
+// when the file already has the same frames in any order.
+bool TagPatch::ApplyShared(TagLib::ID3v2::Tag *tag, Configuration *conf) {
+    bool changed = false;
+    std::vector<bool> done(shared.size(), false);
+    for (size_t i = 0; i < shared.size(); i++) {
+        if (done[i]) continue;
+        const FrameOperation &first = shared[i];
+        std::vector<TagLib::ID3v2::Frame *> group;
+        for (size_t j = i; j < shared.size(); j++) {
+            if (shared[j].id != first.id || (IsDescribed(first.id) && shared[j].description != first.description))
+                continue;
+            done[j] = true;
+            group.push_back(shared[j].frame);
+        }
+        if (Overridden(first)) continue;   // frames stay in staging and are deleted with it
+
+        std::vector<std::string> wanted;
+        for (auto frame : group) {
+            LoadID3v2Attachment(frame, fmap, conf);
+            wanted.push_back(FrameContent(frame, conf));
+        }
+
+        TagLib::ID3v2::FrameList matched;
+        std::vector<std::string> current;
+        TagLib::ID3v2::FrameList frames = tag->frameList(first.id);
+        for (auto frame : frames) {
+            if (IsDescribed(first.id) && FrameDescription(frame) != first.description) continue;
+            matched.append(frame);
+            current.push_back(FrameContent(frame, conf));
+        }
+
+        std::sort(wanted.begin(), wanted.end());
+        std::sort(current.begin(), current.end());
+        if (wanted == current) continue;
+
+        for (auto frame : matched) tag->removeFrame(frame, true);
+        for (auto frame : group) Move(frame, tag);
+        changed = true;
+    }
+    return changed;
+}
+
+bool TagPatch::Apply(TagLib::ID3v2::Tag *tag, Configuration *conf) {
+    bool changed = ApplyShared(tag, conf);
+    for (auto &operation : id3v2) {
+        if (operation.frame != nullptr) LoadID3v2Attachment(operation.frame, fmap, conf);
+
+        if (operation.op == PATCH_APPEND) {
+            Move(operation.frame, tag);
+            changed = true;
+            continue;
+        }
+
+        // copy - the list of the tag changes while frames are removed
+        TagLib::ID3v2::FrameList matched;
+        TagLib::ID3v2::FrameList frames = tag->frameList(operation.id);
+        for (auto frame : frames) {
+            // remove without description removes all user defined frames of the ID
+            if (!IsDescribed(operation.id) || operation.description.isNull()
+                    || FrameDescription(frame) == operation.description)
+                matched.append(frame);
+        }
+
+        if (operation.op == PATCH_SET && matched.size() == 1
+                && FrameContent(matched.front(), conf) == FrameContent(operation.frame, conf))
+            continue;   // frame stays in staging and is deleted with it
+
+        for (auto frame : matched) tag->removeFrame(frame, true);
+        if (operation.op == PATCH_SET) Move(operation.frame, tag);
+        changed = changed || !matched.isEmpty() || operation.op == PATCH_SET;
+    }
+    return changed;
+}
+
+bool TagPatch::Apply(TagLib::Ogg::XiphComment *tag) {
+    bool changed = false;
+    for (auto &operation : xiph) {
+        const TagLib::Ogg::FieldListMap &map = tag->fieldListMap();
+        bool found = map.contains(operation.key);
+        switch (operation.op) {
+            case PATCH_SET:
+                if (found && map[operation.key] == TagLib::StringList(operation.value)) break;
+                tag->addField(operation.key, operation.value, true);
+                changed = true;
+                break;
+            case PATCH_REMOVE:
+                if (!found) break;
+                tag->removeField(operation.key);
+                changed = true;
+                break;
+            case PATCH_APPEND:
+                tag->addField(operation.key, operation.value, false);
+                changed = true;
+                break;
+        }
+    }
+    return changed;
+}
+
+bool TagPatch::Apply(TagLib::FLAC::File *file) {
+    const TagLib::List<TagLib::FLAC::Picture *> current = file->pictureList();
+    bool same = current.size() == pictures.size();
+    for (size_t i = 0; same && i < pictures.size(); i++)
+        same = SamePicture(current[(unsigned int) i], pictures[i]);
+    if (same) return false;
+
+    file->removePictures();
+    for (auto picture : pictures) file->addPicture(picture);
+    pictures.clear();
+    return true;
+}
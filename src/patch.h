@@ -0,0 +1,78 @@
+#ifndef TAGIO_PATCH_H
+#define TAGIO_PATCH_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <taglib/id3v2tag.h>
+#include <taglib/id3v2frame.h>
+#include <taglib/xiphcomment.h>
+#include <taglib/flacfile.h>
+
+#include "configuration.h"
+
+const int PATCH_SET = 1;      // replace all frames (fields) of the ID (key)
+const int PATCH_REMOVE = 2;   // remove all frames (fields) of the ID (key)
+const int PATCH_APPEND = 3;   // add frame (field) keeping the others
+
+// Changes of a patch request applied to the tags parsed from the file, frames
+// which are not named by an operation are left untouched. Operations which do
+// not change the tag (set to the current content, remove of a missing frame)
+// are detected so that unchanged file is not saved at all.
+//
+// TXXX and WXXX frames are identified by ID and description.
+// Frames are imported on the main thread (import.cc), applied on a worker thread.
+class TagPatch {
+public:
+    TagPatch() {}
+    ~TagPatch();
+
+    void ImportID3v2(v8::Array *array, Configuration *conf);
+    void ImportXiphComment(v8::Array *array);
+
+    // Frame created on the worker thread (shared by writeMany). Shared frames
+    // replace the frames of their IDs as one group before the imported operations
+    // are applied, IDs set or removed by the imported operations are left to them.
+    void AddSharedID3v2(TagLib::ID3v2::Frame *frame);
+    // Pictures replacing all pictures of FLAC file, owned by the patch.
+    void SetPictures(const std::vector<TagLib::FLAC::Picture *> &list);
+
+    bool HasID3v2() const { return !id3v2.empty() || !shared.empty(); }
+    bool HasXiphComment() const { return !xiph.empty(); }
+    bool HasPictures() const { return !pictures.empty(); }
+
+    // True when the tag changed. Applied frames are owned by the tag.
+    bool Apply(TagLib::ID3v2::Tag *tag, Configuration *conf);
+    bool Apply(TagLib::Ogg::XiphComment *tag);
+    bool Apply(TagLib::FLAC::File *file);
+
+private:
+    struct FrameOperation {
+        int op;
+        TagLib::ByteVector id;
+        TagLib::String description;
+        TagLib::ID3v2::Frame *frame;    // set and append, owned by staging until applied
+    };
+
+    struct FieldOperation {
+        int op;
+        TagLib::String key;
+        TagLib::String value;
+    };
+
+    TagLib::ID3v2::Tag staging;
+    std::map<uintptr_t, std::string> fmap;
+    std::vector<FrameOperation> id3v2;
+    std::vector<FrameOperation> shared;
+    std::vector<FieldOperation> xiph;
+    std::vector<TagLib::FLAC::Picture *> pictures;
+
+    static TagLib::String FrameDescription(TagLib::ID3v2::Frame *frame);
+
+    void Move(TagLib::ID3v2::Frame *frame, TagLib::ID3v2::Tag *tag);
+    bool Overridden(const FrameOperation &operation) const;
+    bool ApplyShared(TagLib::ID3v2::Tag *tag, Configuration *conf);
+};
+
+
+#endif //TAGIO_PATCH_H
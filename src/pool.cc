@@ -0,0 +1,192 @@
+#include "pool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::deque;
+using std::mutex;
+using std::unique_lock;
+using std::condition_variable;
+using std::vector;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using Nan::AsyncWorker;
+using Nan::New;
+
+// Job of a lane - worker of a request or a task helping a running one.
+struct Job {
+    AsyncWorker *worker;
+    std::function<void()> task;
+};
+
+// Fixed set of threads with two priority lanes. Bulk jobs may occupy all
+// threads but one, so an interactive request never waits for a scan.
+// Threads are detached, the pool lives until the process exits.
+class ThreadPool {
+public:
+    static ThreadPool *Instance() {
+        static ThreadPool *pool = new ThreadPool();
+        return pool;
+    }
+
+    void Configure(uint32_t threads) {
+        unique_lock<mutex> guard(lock);
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 4;
+        size = threads;
+        while (alive < size) {
+            alive++;
+            std::thread(&ThreadPool::Run, this).detach();
+        }
+        ready.notify_all(); // let superfluous threads exit
+    }
+
+    void Queue(AsyncWorker *worker, int priority) {
+        if (async == nullptr) {
+            async = new uv_async_t;
+            uv_async_init(uv_default_loop(), async, &ThreadPool::OnComplete);
+            uv_unref((uv_handle_t *) async); // idle pool does not keep the process alive
+        }
+        if (size == 0) Configure(0);
+        if (inFlight++ == 0) uv_ref((uv_handle_t *) async);
+        unique_lock<mutex> guard(lock);
+        lanes[priority == PRIORITY_BULK ? PRIORITY_BULK : PRIORITY_INTERACTIVE].push_back({ worker, nullptr });
+        ready.notify_one();
+    }
+
+    // Task is queued from a worker thread, it has no completion on the main thread.
+    void QueueTask(std::function<void()> task, int priority) {
+        unique_lock<mutex> guard(lock);
+        lanes[priority == PRIORITY_BULK ? PRIORITY_BULK : PRIORITY_INTERACTIVE].push_back({ nullptr, std::move(task) });
+        ready.notify_one();
+    }
+
+    uint32_t Size() {
+        unique_lock<mutex> guard(lock);
+        return size;
+    }
+
+private:
+    ThreadPool() {}
+
+    mutex lock;
+    condition_variable ready;
+    deque<Job> lanes[2];
+    uint32_t size = 0;
+    uint32_t alive = 0;
+    uint32_t runningBulk = 0;
+
+    // completion - async handle and in flight counter are used on the main thread only
+    uv_async_t *async = nullptr;
+    uint32_t inFlight = 0;
+    mutex doneLock;
+    vector<AsyncWorker *> done;
+
+    bool CanRun() {
+        uint32_t maxBulk = size > 1 ? size - 1 : 1;
+        return !lanes[PRIORITY_INTERACTIVE].empty() ||
+               (!lanes[PRIORITY_BULK].empty() && runningBulk < maxBulk);
+    }
+
+    void Run() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            ready.wait(guard, [this] { return alive > size || CanRun(); });
+            if (alive > size) {
+                alive--;
+                return;
+            }
+            int lane = lanes[PRIORITY_INTERACTIVE].empty() ? PRIORITY_BULK : PRIORITY_INTERACTIVE;
+            Job job = std::move(lanes[lane].front());
+            lanes[lane].pop_front();
+            if (lane == PRIORITY_BULK) runningBulk++;
+            guard.unlock();
+
+            if (job.worker == nullptr) {
+                job.task();
+            } else {
+                job.worker->Execute();
+                {
+                    unique_lock<mutex> doneGuard(doneLock);
+                    done.push_back(job.worker);
+                }
+                uv_async_send(async);
+            }
+
+            guard.lock();
+            if (lane == PRIORITY_BULK) runningBulk--;
+        }
+    }
+
+    static void OnComplete(uv_async_t *handle) {
+        ThreadPool *pool = Instance();
+        vector<AsyncWorker *> completed;
+        {
+            unique_lock<mutex> guard(pool->doneLock);
+            completed.swap(pool->done);
+        }
+        for (auto worker : completed) {
+            worker->WorkComplete();
+            worker->Destroy();
+        }
+        pool->inFlight -= (uint32_t) completed.size();
+        if (pool->inFlight == 0) uv_unref((uv_handle_t *) pool->async);
+    }
+};
+
+
+void PoolQueueWorker(AsyncWorker *worker, int priority) {
+    ThreadPool::Instance()->Queue(worker, priority);
+}
+
+// Helpers share the state with the request, a helper started after the
+// request finished its part returns without touching the request.
+struct ParallelState {
+    mutex lock;
+    condition_variable finished;
+    std::function<void()> body;
+    uint32_t running = 0;
+    bool closed = false;
+};
+
+void PoolParallel(uint32_t parallelism, int priority, std::function<void()> body) {
+    ThreadPool *pool = ThreadPool::Instance();
+    uint32_t size = pool->Size();
+    if (parallelism == 0 || parallelism > size) parallelism = size;
+    auto state = std::make_shared<ParallelState>();
+    state->body = std::move(body);
+    for (uint32_t i = 1; i < parallelism; i++) {
+        pool->QueueTask([state] {
+            {
+                unique_lock<mutex> guard(state->lock);
+                if (state->closed) return;
+                state->running++;
+            }
+            state->body();
+            unique_lock<mutex> guard(state->lock);
+            if (--state->running == 0) state->finished.notify_all();
+        }, priority);
+    }
+    state->body();
+    unique_lock<mutex> guard(state->lock);
+    state->closed = true;
+    state->finished.wait(guard, [&state] { return state->running == 0; });
+}
+
+int RequestPriority(Object *request) {
+    Local<String> priorityKey = New<String>("priority").ToLocalChecked();
+    if (!request->Has(priorityKey)) return PRIORITY_INTERACTIVE;
+    String::Utf8Value priority(request->Get(priorityKey));
+    return (*priority != nullptr && std::string(*priority) == "BULK") ? PRIORITY_BULK : PRIORITY_INTERACTIVE;
+}
+
+NAN_METHOD(ConfigurePool) {
+    ThreadPool::Instance()->Configure(info[0]->Uint32Value());
+}
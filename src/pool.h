@@ -0,0 +1,29 @@
+#ifndef TAGIO_POOL_H
+#define TAGIO_POOL_H
+
+#include <nan.h>
+#include <functional>
+
+const int PRIORITY_INTERACTIVE = 0; // User facing requests - always served first
+const int PRIORITY_BULK = 1;        // Background scans - never take the last free thread
+
+// Queue worker on tagio's own thread pool instead of libuv's one,
+// so tag reads do not compete with fs and crypto work of the application.
+// Must be called on the main thread, the worker is completed and destroyed there.
+void PoolQueueWorker(Nan::AsyncWorker *worker, int priority);
+
+// Runs body of a request on its pool thread and on up to parallelism - 1
+// more threads of the pool (0 - pool size, never more), queued as tasks in the
+// lane of the request. Body must take its share of the work until none is
+// left. Returns when every started body returned, helpers which did not get a
+// thread before that are skipped, so a busy pool only lowers the parallelism.
+// Called on a pool thread.
+void PoolParallel(uint32_t parallelism, int priority, std::function<void()> body);
+
+// Priority of the request - "priority" property, interactive by default.
+int RequestPriority(v8::Object *request);
+
+// configurePool(threads) - 0 means number of CPUs
+NAN_METHOD(ConfigurePool);
+
+#endif //TAGIO_POOL_H
@@ -0,0 +1,30 @@
+#include "projection.h"
+
+using namespace std;
+
+void Projection::Add(const string &field) {
+    if (field.empty()) return;
+    fields.insert(field);
+    string key(field);
+    for (auto &c: key)
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    upper.insert(key);
+}
+
+bool Projection::HasFrame(const TagLib::ByteVector &id) const {
+    return All() || fields.count(string(id.data(), id.size())) > 0;
+}
+
+bool Projection::HasXiphKey(const TagLib::String &key) const {
+    // TagLib keeps Xiph comment keys upper-cased
+    return All() || upper.count(key.to8Bit(true)) > 0;
+}
+
+string Projection::Canonical() const {
+    string s;
+    for (auto const& field: fields) {
+        s += field;
+        s += '\n';
+    }
+    return s;
+}
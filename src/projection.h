@@ -0,0 +1,39 @@
+#ifndef TAGIO_PROJECTION_H
+#define TAGIO_PROJECTION_H
+
+#include <set>
+#include <string>
+#include <taglib/tbytevector.h>
+#include <taglib/tstring.h>
+
+#include "result.h"
+
+// Fields requested by a read - ID3v2 frame IDs (TIT2, APIC ...), Xiph comment
+// keys (matched case-insensitively) and generic tag fields (title, year ...).
+// Unselected frames and comments are skipped before their text is decoded or
+// attached files are written. Empty projection selects everything.
+class Projection {
+public:
+    void Add(const std::string &field);
+
+    bool All() const { return fields.empty(); }
+
+    bool Has(const char *field) const { return All() || fields.count(field) > 0; }
+    bool HasFrame(const TagLib::ByteVector &id) const;
+    bool HasXiphKey(const TagLib::String &key) const;
+
+    // Tag objects are not shaped when some of their fields may be missing.
+    ObjectShape Shape(ObjectShape shape) const { return All() ? shape : SHAPE_NONE; }
+
+    // Sorted field list - part of the metadata cache key.
+    std::string Canonical() const;
+
+private:
+    std::set<std::string> fields;
+    std::set<std::string> upper;    // Xiph comment keys
+};
+
+void ImportProjection(v8::Array *array, Projection *projection);
+
+
+#endif //TAGIO_PROJECTION_H
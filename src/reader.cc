@@ -0,0 +1,112 @@
+#include "reader.h"
+#include "cache.h"
+#include "generic.h"
+#include "mpeg.h"
+#include "flac.h"
+#include "ogg.h"
+#include "mp4.h"
+#include "timings.h"
+
+#include <set>
+#include <utility>
+#include <taglib/fileref.h>
+
+using std::string;
+
+static string Lower(string s) {
+    for (auto &c: s)
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    return s;
+}
+
+string FileExtension(const string &path) {
+    size_t dot = path.find_last_of('.');
+    size_t sep = path.find_last_of("/\\");
+    if (dot == string::npos || (sep != string::npos && dot < sep)) return "";
+    return Lower(path.substr(dot));
+}
+
+bool Reader::Open() {
+    PhaseTimer timer(PHASE_OPEN);
+    valid = OpenFile();
+    return valid;
+}
+
+void Reader::Export(Result *result) {
+    ExportRequest(result);
+    ExportContent(result);
+}
+
+// Path and configuration belong to the request, not to the content of the file.
+void Reader::ExportRequest(Result *result) {
+    result->SetString("path", path);
+    if (conf->ConfigurationReadable()) {
+        ExportConfiguration(conf, result->SetObject("configuration", SHAPE_CONFIGURATION));
+    }
+}
+
+// Cached content does not contain path and configuration - hard links and requests
+// differing only in options which do not change the content share one entry.
+void Reader::Read(Result *result) {
+    MetadataCache *cache = MetadataCache::Get(conf);
+    CacheKey key;
+    if (cache == nullptr || !MetadataCache::MakeKey(path, conf, &key)) {
+        Open();
+        Export(result);
+        return;
+    }
+
+    Result content = Result::Object();
+    bool found;
+    {
+        PhaseTimer timer(PHASE_CACHE);
+        found = cache->Lookup(key, &content);
+    }
+    if (!found) {
+        Open();
+        ExportContent(&content);
+        if (valid) {
+            PhaseTimer timer(PHASE_CACHE);
+            cache->Store(key, content);
+        }
+    }
+    ExportRequest(result);
+    result->Append(std::move(content));
+}
+
+void Reader::ExportContent(Result *result) {
+    PhaseTimer timer(PHASE_EXPORT);
+    if (!valid) {
+        result->SetString("error", "Unable to open file");
+    }
+
+    ExportTags(result);
+}
+
+Reader *NewReader(const string &path, Configuration *conf) {
+    string ext = FileExtension(path);
+    if (ext.compare(".mp3") == 0)
+        return NewMPEGReader(path, conf);
+    else if (ext.compare(".flac") == 0)
+        return NewFLACReader(path, conf);
+    else if (ext.compare(".ogg") == 0 || ext.compare(".opus") == 0)
+        return NewOggReader(path, conf);
+    else if (ext.compare(".m4a") == 0 || ext.compare(".m4b") == 0 || ext.compare(".mp4") == 0)
+        return NewMP4Reader(path, conf);
+    else
+        return NewGenericReader(path, conf);
+}
+
+// Extensions of MPEGReader, FLACReader, OggReader, MP4Reader and formats known to TagLib::FileRef.
+static std::set<string> ReadableExtensions() {
+    std::set<string> extensions = { ".mp3", ".flac" };
+    TagLib::StringList generic = TagLib::FileRef::defaultFileExtensions();
+    for (auto it = generic.begin(); it != generic.end(); it++)
+        extensions.insert(Lower('.' + it->to8Bit(true)));
+    return extensions;
+}
+
+bool IsReadable(const string &path) {
+    static const std::set<string> extensions = ReadableExtensions();
+    return extensions.count(FileExtension(path)) > 0;
+}
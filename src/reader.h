@@ -0,0 +1,48 @@
+#ifndef TAGIO_READER_H
+#define TAGIO_READER_H
+
+#include <string>
+
+#include "configuration.h"
+#include "result.h"
+
+// Reads tags of a single file.
+// Open() and Export() run on a worker thread, the result is materialized
+// as V8 values on the main thread.
+// Configuration is borrowed - the owner (worker) must outlive the reader.
+class Reader {
+public:
+    Reader(const std::string &path, Configuration *conf) : path(path), conf(conf) {}
+    virtual ~Reader() {}
+
+    bool Open();
+    void Export(Result *result);
+
+    // Open and export, unchanged file is taken from the metadata cache without opening it.
+    void Read(Result *result);
+
+    const std::string &Path() const { return path; }
+
+protected:
+    std::string path;
+    Configuration *conf;
+    bool valid = false;
+
+    void ExportRequest(Result *result);
+    void ExportContent(Result *result);
+
+    virtual bool OpenFile() = 0;
+    virtual void ExportTags(Result *result) = 0;
+};
+
+// Extension of the file name including the dot in lower case, empty when there is none.
+std::string FileExtension(const std::string &path);
+
+// Select reader by file extension - same dispatch as getNativeReadMethod in lib/index.js.
+Reader *NewReader(const std::string &path, Configuration *conf);
+
+// File has extension of a format NewReader can read (used by directory scan).
+bool IsReadable(const std::string &path);
+
+
+#endif //TAGIO_READER_H
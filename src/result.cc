@@ -0,0 +1,187 @@
+#include "result.h"
+
+#include <cstring>
+#include <utility>
+
+using std::string;
+
+Result Result::Object(ObjectShape shape) {
+    Result result;
+    result.type = OBJECT;
+    result.shape = shape;
+    return result;
+}
+
+Result Result::Array(size_t size) {
+    Result result;
+    result.type = ARRAY;
+    result.items.reserve(size);
+    return result;
+}
+
+Result *Result::Add(const char *key, Result &&value) {
+    if (key != nullptr) keys.push_back(key);
+    items.push_back(std::move(value));
+    return &items.back();
+}
+
+void Result::SetBoolean(const char *key, bool value) {
+    Result result;
+    result.type = BOOLEAN;
+    result.boolean = value;
+    Add(key, std::move(result));
+}
+
+void Result::SetNumber(const char *key, double value) {
+    Result result;
+    result.type = NUMBER;
+    result.number = value;
+    Add(key, std::move(result));
+}
+
+void Result::SetString(const char *key, string value) {
+    Result result;
+    result.type = STRING;
+    result.text = std::move(value);
+    Add(key, std::move(result));
+}
+
+// Byte vector is implicitly shared - no bytes are copied.
+void Result::SetBuffer(const char *key, const TagLib::ByteVector &value) {
+    Result result;
+    result.type = BUFFER;
+    result.buffer = value;
+    Add(key, std::move(result));
+}
+
+Result *Result::SetObject(const char *key, ObjectShape shape) {
+    return Add(key, Object(shape));
+}
+
+Result *Result::SetArray(const char *key, size_t size) {
+    return Add(key, Array(size));
+}
+
+void Result::PushNumber(double value) {
+    SetNumber(nullptr, value);
+}
+
+void Result::PushString(string value) {
+    SetString(nullptr, std::move(value));
+}
+
+Result *Result::PushObject(ObjectShape shape) {
+    return Add(nullptr, Object(shape));
+}
+
+void Result::Append(Result &&other) {
+    for (size_t i = 0; i < other.items.size(); i++) {
+        keys.push_back(std::move(other.keys[i]));
+        items.push_back(std::move(other.items[i]));
+    }
+    other.keys.clear();
+    other.items.clear();
+}
+
+static void PutUint32(string &out, uint32_t value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void PutBytes(string &out, const char *data, size_t size) {
+    PutUint32(out, (uint32_t) size);
+    out.append(data, size);
+}
+
+static bool GetUint32(const char *&data, const char *end, uint32_t *value) {
+    if ((size_t) (end - data) < sizeof(uint32_t)) return false;
+    memcpy(value, data, sizeof(uint32_t));
+    data += sizeof(uint32_t);
+    return true;
+}
+
+static bool GetBytes(const char *&data, const char *end, const char **bytes, uint32_t *size) {
+    if (!GetUint32(data, end, size) || (size_t) (end - data) < *size) return false;
+    *bytes = data;
+    data += *size;
+    return true;
+}
+
+// type byte followed by value, containers by item count and items (objects with keys)
+void Result::Serialize(string &out) const {
+    out.push_back((char) type);
+    switch (type) {
+        case BOOLEAN:
+            out.push_back(boolean ? 1 : 0);
+            break;
+        case NUMBER:
+            out.append(reinterpret_cast<const char *>(&number), sizeof(number));
+            break;
+        case STRING:
+            PutBytes(out, text.data(), text.size());
+            break;
+        case BUFFER:
+            PutBytes(out, buffer.data(), buffer.size());
+            break;
+        case ARRAY:
+            PutUint32(out, (uint32_t) items.size());
+            for (auto &item : items) item.Serialize(out);
+            break;
+        case OBJECT:
+            out.push_back((char) shape);
+            PutUint32(out, (uint32_t) items.size());
+            for (size_t i = 0; i < items.size(); i++) {
+                PutBytes(out, keys[i].data(), keys[i].size());
+                items[i].Serialize(out);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool Result::Deserialize(const char *&data, const char *end) {
+    const char *bytes;
+    uint32_t size, count;
+    if (data >= end || *data < UNDEFINED || *data > OBJECT) return false;
+    type = (Type) *data++;
+    switch (type) {
+        case BOOLEAN:
+            if (data >= end) return false;
+            boolean = *data++ != 0;
+            return true;
+        case NUMBER:
+            if ((size_t) (end - data) < sizeof(number)) return false;
+            memcpy(&number, data, sizeof(number));
+            data += sizeof(number);
+            return true;
+        case STRING:
+            if (!GetBytes(data, end, &bytes, &size)) return false;
+            text.assign(bytes, size);
+            return true;
+        case BUFFER:
+            if (!GetBytes(data, end, &bytes, &size)) return false;
+            buffer = TagLib::ByteVector(bytes, size);
+            return true;
+        case ARRAY:
+            // every item takes at least one byte - guards against corrupted counts
+            if (!GetUint32(data, end, &size) || size > (size_t) (end - data)) return false;
+            items.resize(size);
+            for (auto &item : items)
+                if (!item.Deserialize(data, end)) return false;
+            return true;
+        case OBJECT:
+            if (data >= end || *data < 0 || *data > SHAPE_NONE) return false;
+            shape = (ObjectShape) *data++;
+            if (!GetUint32(data, end, &count) || count > (size_t) (end - data)) return false;
+            keys.resize(count);
+            items.resize(count);
+            for (uint32_t i = 0; i < count; i++) {
+                if (!GetBytes(data, end, &bytes, &size)) return false;
+                keys[i].assign(bytes, size);
+                if (!items[i].Deserialize(data, end)) return false;
+            }
+            return true;
+        default:
+            return true;
+    }
+}
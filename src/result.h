@@ -0,0 +1,83 @@
+#ifndef TAGIO_RESULT_H
+#define TAGIO_RESULT_H
+
+#include <string>
+#include <vector>
+#include <taglib/tbytevector.h>
+
+// V8 is only named here - imports (import.cc), materialization (materialize.cc) and
+// the requests (workers.cc, batch.cc, scan.cc) include nan.h, the readers and
+// writers of the formats build without Node (iobench links them).
+namespace v8 {
+class Value;
+class Object;
+class Array;
+template <class T> class Local;
+}
+
+// Objects materialized from a shared template (keys.cc).
+enum ObjectShape {
+    SHAPE_TAG,
+    SHAPE_AUDIO_PROPERTIES,
+    SHAPE_CONFIGURATION,
+    SHAPE_ID3V1,
+    SHAPE_APE,
+    SHAPE_COUNT,
+    SHAPE_NONE = SHAPE_COUNT    // plain object
+};
+
+// Plain C++ value built by exports on a worker thread.
+// Strings are already transcoded to UTF-8 and attachments already stored,
+// Materialize() on the main thread only creates the V8 values.
+//
+// Pointers returned by SetObject/SetArray/PushObject stay valid until
+// the next value is added to the same parent.
+class Result {
+public:
+    enum Type { UNDEFINED, BOOLEAN, NUMBER, STRING, BUFFER, ARRAY, OBJECT };
+
+    Result() {}
+
+    static Result Object(ObjectShape shape = SHAPE_NONE);
+    static Result Array(size_t size = 0);
+
+    // object fields
+    void SetBoolean(const char *key, bool value);
+    void SetNumber(const char *key, double value);
+    void SetString(const char *key, std::string value);
+    void SetBuffer(const char *key, const TagLib::ByteVector &value);
+    Result *SetObject(const char *key, ObjectShape shape = SHAPE_NONE);
+    Result *SetArray(const char *key, size_t size = 0);
+
+    // array items
+    void PushNumber(double value);
+    void PushString(std::string value);
+    Result *PushObject(ObjectShape shape = SHAPE_NONE);
+
+    // move all fields of other object to the end of this one
+    void Append(Result &&other);
+
+    Type GetType() const { return type; }
+
+    // compact binary form used by the metadata cache
+    void Serialize(std::string &out) const;
+    bool Deserialize(const char *&data, const char *end);
+
+    // Buffers are handed over to the created values, so materialize a result once (materialize.cc).
+    v8::Local<v8::Value> Materialize() const;
+
+private:
+    Type type = UNDEFINED;
+    ObjectShape shape = SHAPE_NONE;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    mutable TagLib::ByteVector buffer; // handed over to JS by Materialize()
+    std::vector<std::string> keys;  // object only, parallel to items
+    std::vector<Result> items;
+
+    Result *Add(const char *key, Result &&value);
+};
+
+
+#endif //TAGIO_RESULT_H
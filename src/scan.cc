@@ -0,0 +1,250 @@
+#include "scan.h"
+#include "reader.h"
+#include "pool.h"
+
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+using std::string;
+using std::vector;
+using std::set;
+using v8::Function;
+using v8::Local;
+using v8::Value;
+using v8::String;
+using v8::Object;
+using v8::Array;
+using Nan::AsyncWorker;
+using Nan::Callback;
+using Nan::HandleScope;
+using Nan::New;
+using Nan::Null;
+
+const uint32_t DEFAULT_LIST_LIMIT = 1024;
+
+static string Lower(string s) {
+    for (auto &c: s)
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    return s;
+}
+
+static string JoinPath(const string &directory, const char *name) {
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+    const char separator = '\\';
+#else
+    const char separator = '/';
+#endif
+    if (!directory.empty() && directory.back() == separator) return directory + name;
+    return directory + separator + name;
+}
+
+// Directory on the stack of tagio.scan. Directory listed up to the limit is
+// put back with the position of its next entry, opaque to JS - telldir cookie
+// on Linux (valid for a new stream of the same directory), number of entries
+// to skip elsewhere. Empty position lists the directory from its start.
+struct Directory {
+    string path;
+    string position;
+};
+
+// Lists directories popped from the stack of tagio.scan until the limit of
+// files and found directories is reached, a large directory is listed in
+// parts. Entry types come from the directory listing itself (d_type / find
+// data), files are stat-ed only when the type is unknown or the entry is a
+// symbolic link. Linked directories are not followed.
+class ListWorker : public AsyncWorker {
+public:
+    ListWorker(Callback *callback, vector<Directory> *directories, set<string> *extensions, uint32_t limit)
+            : AsyncWorker(callback), directories(directories), extensions(extensions), limit(limit) {}
+
+    ~ListWorker() {
+        delete directories;
+        delete extensions;
+    }
+
+    void Execute() {
+        while (!directories->empty() && !Full()) {
+            Directory directory = directories->back();
+            directories->pop_back();
+            if (!List(directory)) errors.push_back(directory.path);
+        }
+    }
+
+    void HandleOKCallback() {
+        HandleScope scope;
+        Local<Object> response = New<Object>();
+        // not listed directories go back to the stack first, new ones are listed next
+        // and the rest of the directory stopped at the limit before them
+        for (auto &path : found) directories->push_back({ path, "" });
+        if (!rest.path.empty()) directories->push_back(rest);
+        response->Set(New<String>("files").ToLocalChecked(), ToArray(files));
+        response->Set(New<String>("directories").ToLocalChecked(), ToArray(*directories));
+        response->Set(New<String>("errors").ToLocalChecked(), ToArray(errors));
+        Local<Value> argv[] = { Null(), response };
+        callback->Call(2, argv);
+    }
+
+private:
+    vector<Directory> *directories;
+    set<string> *extensions;
+    uint32_t limit;
+
+    vector<string> files;
+    vector<string> found;
+    vector<string> errors;
+    Directory rest;
+
+    static Local<Array> ToArray(const vector<string> &strings) {
+        Local<Array> array = New<Array>((int) strings.size());
+        for (uint32_t i = 0; i < strings.size(); i++)
+            array->Set(i, New<String>(strings[i]).ToLocalChecked());
+        return array;
+    }
+
+    // directory from its start as path, the rest of it as { path, position }
+    static Local<Array> ToArray(const vector<Directory> &directories) {
+        Local<Array> array = New<Array>((int) directories.size());
+        for (uint32_t i = 0; i < directories.size(); i++) {
+            const Directory &directory = directories[i];
+            Local<String> path = New<String>(directory.path).ToLocalChecked();
+            if (directory.position.empty()) {
+                array->Set(i, path);
+                continue;
+            }
+            Local<Object> object = New<Object>();
+            object->Set(New<String>("path").ToLocalChecked(), path);
+            object->Set(New<String>("position").ToLocalChecked(), New<String>(directory.position).ToLocalChecked());
+            array->Set(i, object);
+        }
+        return array;
+    }
+
+    bool Full() const {
+        return files.size() + found.size() >= limit;
+    }
+
+    bool Accepted(const string &path) {
+        if (extensions->empty()) return IsReadable(path);
+        size_t dot = path.find_last_of('.');
+        return dot != string::npos && extensions->count(Lower(path.substr(dot))) > 0;
+    }
+
+    void Add(const string &path, bool directory) {
+        if (directory) found.push_back(path);
+        else if (Accepted(path)) files.push_back(path);
+    }
+
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+    bool List(const Directory &directory) {
+        WIN32_FIND_DATAA data;
+        HANDLE handle = FindFirstFileA(JoinPath(directory.path, "*").c_str(), &data);
+        if (handle == INVALID_HANDLE_VALUE) return false;
+        unsigned long long skip = std::strtoull(directory.position.c_str(), nullptr, 10);
+        unsigned long long read = 0;
+        bool more = true;
+        for (; more && read < skip; read++) more = FindNextFileA(handle, &data) != 0;
+        for (; more && !Full(); read++, more = FindNextFileA(handle, &data) != 0) {
+            string name(data.cFileName);
+            if (name == "." || name == "..") continue;
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) continue;
+            Add(JoinPath(directory.path, data.cFileName), (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+        }
+        if (more) rest = { directory.path, std::to_string(read) };
+        FindClose(handle);
+        return true;
+    }
+#else
+    bool List(const Directory &directory) {
+        DIR *dir = opendir(directory.path.c_str());
+        if (dir == nullptr) return false;
+        struct dirent *entry = nullptr;
+#if defined(__linux__)
+        if (!directory.position.empty()) seekdir(dir, std::strtol(directory.position.c_str(), nullptr, 10));
+#else
+        unsigned long long skip = std::strtoull(directory.position.c_str(), nullptr, 10);
+        unsigned long long read = 0;
+        for (; read < skip && readdir(dir) != nullptr; read++);
+#endif
+        while (!Full()) {
+            if ((entry = readdir(dir)) == nullptr) break;
+#if !defined(__linux__)
+            read++;
+#endif
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+            string path = JoinPath(directory.path, name);
+#if defined(_DIRENT_HAVE_D_TYPE) || defined(__APPLE__)
+            if (entry->d_type == DT_DIR) { Add(path, true); continue; }
+            if (entry->d_type == DT_REG) { Add(path, false); continue; }
+            if (entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) continue;
+#endif
+            struct stat st;
+            if (lstat(path.c_str(), &st) != 0) continue;
+            if (S_ISDIR(st.st_mode)) Add(path, true);
+            else if (S_ISREG(st.st_mode)) Add(path, false);
+            else if (S_ISLNK(st.st_mode) && stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) Add(path, false);
+        }
+        if (Full()) {
+#if defined(__linux__)
+            rest = { directory.path, std::to_string(telldir(dir)) };
+#else
+            rest = { directory.path, std::to_string(read) };
+#endif
+        }
+        closedir(dir);
+        return true;
+    }
+#endif
+};
+
+
+NAN_METHOD(ListDirectories) {
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> directoriesKey = New<String>("directories").ToLocalChecked();
+    Local<String> extensionsKey = New<String>("extensions").ToLocalChecked();
+    Local<String> limitKey = New<String>("limit").ToLocalChecked();
+
+    Local<String> pathKey = New<String>("path").ToLocalChecked();
+    Local<String> positionKey = New<String>("position").ToLocalChecked();
+
+    Local<Array> directoriesVal = reqObj->Get(directoriesKey).As<Array>();
+    vector<Directory> *directories = new vector<Directory>();
+    directories->reserve(directoriesVal->Length());
+    for (uint32_t i = 0; i < directoriesVal->Length(); i++) {
+        Local<Value> directoryVal = directoriesVal->Get(i);
+        if (directoryVal->IsString()) {
+            String::Utf8Value pathVal(directoryVal);
+            directories->push_back({ string(*pathVal), "" });
+            continue;
+        }
+        Local<Object> directoryObj = directoryVal.As<Object>();
+        String::Utf8Value pathVal(directoryObj->Get(pathKey));
+        String::Utf8Value positionVal(directoryObj->Get(positionKey));
+        directories->push_back({ string(*pathVal), string(*positionVal) });
+    }
+
+    set<string> *extensions = new set<string>();
+    if (reqObj->Has(extensionsKey)) {
+        Local<Array> extensionsVal = reqObj->Get(extensionsKey).As<Array>();
+        for (uint32_t i = 0; i < extensionsVal->Length(); i++) {
+            String::Utf8Value extensionVal(extensionsVal->Get(i));
+            extensions->insert(Lower(string(*extensionVal)));
+        }
+    }
+
+    uint32_t limit = DEFAULT_LIST_LIMIT;
+    if (reqObj->Has(limitKey)) limit = reqObj->Get(limitKey)->Uint32Value();
+    if (limit == 0) limit = DEFAULT_LIST_LIMIT;
+
+    PoolQueueWorker(new ListWorker(callback, directories, extensions, limit), RequestPriority(*reqObj));
+}
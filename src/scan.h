@@ -0,0 +1,9 @@
+#ifndef TAGIO_SCAN_H
+#define TAGIO_SCAN_H
+
+#include <nan.h>
+
+// listDirectories(request, callback) - one step of tagio.scan directory walk
+NAN_METHOD(ListDirectories);
+
+#endif //TAGIO_SCAN_H
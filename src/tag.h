@@ -1,9 +1,10 @@
 #ifndef TAGIO_TAG_H
 #define TAGIO_TAG_H
 
-#include <nan.h>
 #include <taglib/tag.h>
 #include <taglib/tstring.h>
+#include "result.h"
+#include "projection.h"
 
 struct GenericTag {
     TagLib::String title;
@@ -15,8 +16,8 @@ struct GenericTag {
     TagLib::String comment;
 };
 
-void ExportTag(GenericTag *tag, v8::Object *object) ;
-void ExportTag(TagLib::Tag *tag, v8::Object *object);
+void ExportTag(GenericTag *tag, Result *object, const Projection &fields);
+void ExportTag(TagLib::Tag *tag, Result *object, const Projection &fields);
 void ImportTag(v8::Object *object, TagLib::Tag *tag);
 void ImportTag(v8::Object *object, GenericTag *tag);
 
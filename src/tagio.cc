@@ -1,7 +1,9 @@
 #include <nan.h>
-#include "generic.h"   // NOLINT(build/include)
-#include "mpeg.h"   // NOLINT(build/include)
-#include "flac.h"   // NOLINT(build/include)
+#include "workers.h"   // NOLINT(build/include)
+#include "batch.h"   // NOLINT(build/include)
+#include "pool.h"   // NOLINT(build/include)
+#include "scan.h"   // NOLINT(build/include)
+#include "materialize.h"   // NOLINT(build/include)
 
 
 using v8::FunctionTemplate;
@@ -18,8 +20,20 @@ NAN_MODULE_INIT(InitAll) {
     Set(target, New<String>("writeGeneric").ToLocalChecked(), GetFunction(New<FunctionTemplate>(WriteGeneric)).ToLocalChecked());
     Set(target, New<String>("readMPEG").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ReadMPEG)).ToLocalChecked());
     Set(target, New<String>("writeMPEG").ToLocalChecked(), GetFunction(New<FunctionTemplate>(WriteMPEG)).ToLocalChecked());
+    Set(target, New<String>("patchMPEG").ToLocalChecked(), GetFunction(New<FunctionTemplate>(PatchMPEG)).ToLocalChecked());
     Set(target, New<String>("readFLAC").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ReadFLAC)).ToLocalChecked());
     Set(target, New<String>("writeFLAC").ToLocalChecked(), GetFunction(New<FunctionTemplate>(WriteFLAC)).ToLocalChecked());
+    Set(target, New<String>("patchFLAC").ToLocalChecked(), GetFunction(New<FunctionTemplate>(PatchFLAC)).ToLocalChecked());
+    Set(target, New<String>("readOgg").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ReadOgg)).ToLocalChecked());
+    Set(target, New<String>("writeOgg").ToLocalChecked(), GetFunction(New<FunctionTemplate>(WriteOgg)).ToLocalChecked());
+    Set(target, New<String>("patchOgg").ToLocalChecked(), GetFunction(New<FunctionTemplate>(PatchOgg)).ToLocalChecked());
+    Set(target, New<String>("readMP4").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ReadMP4)).ToLocalChecked());
+    Set(target, New<String>("writeMP4").ToLocalChecked(), GetFunction(New<FunctionTemplate>(WriteMP4)).ToLocalChecked());
+    Set(target, New<String>("readMany").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ReadMany)).ToLocalChecked());
+    Set(target, New<String>("writeMany").ToLocalChecked(), GetFunction(New<FunctionTemplate>(WriteMany)).ToLocalChecked());
+    Set(target, New<String>("listDirectories").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ListDirectories)).ToLocalChecked());
+    Set(target, New<String>("stats").ToLocalChecked(), GetFunction(New<FunctionTemplate>(Stats)).ToLocalChecked());
+    Set(target, New<String>("configurePool").ToLocalChecked(), GetFunction(New<FunctionTemplate>(ConfigurePool)).ToLocalChecked());
 }
 
 NODE_MODULE(addon, InitAll)
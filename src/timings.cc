@@ -0,0 +1,94 @@
+#include "timings.h"
+
+#include <algorithm>
+#include <mutex>
+
+// Bucket 0 counts requests under 2 microseconds, bucket i those from 2^i up to
+// 2^(i+1) microseconds, the last one everything longer (about 8 seconds).
+const int HISTOGRAM_SIZE = 24;
+
+static const char *const PHASE_NAMES[PHASE_COUNT] = {
+    "open", "cache", "export", "hash", "store", "save", "materialize"
+};
+
+struct PhaseStats {
+    uint64_t count;
+    uint64_t ns;
+    uint64_t bytes;
+    uint64_t histogram[HISTOGRAM_SIZE];
+};
+
+static std::mutex statsLock;
+static PhaseStats stats[PHASE_COUNT];
+
+static thread_local Timings *current = nullptr;
+
+static int Bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+    while (us >= 2 && bucket < HISTOGRAM_SIZE - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+Timings *Timings::Current() {
+    return current;
+}
+
+void Timings::Add(Phase phase, uint64_t elapsed, uint64_t size) {
+    ns[phase] += elapsed;
+    bytes[phase] += size;
+    count[phase]++;
+}
+
+void Timings::Export(Result *object) const {
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        if (count[phase] == 0) continue;
+        Result *o = object->SetObject(PHASE_NAMES[phase]);
+        o->SetNumber("ns", (double) ns[phase]);
+        o->SetNumber("bytes", (double) bytes[phase]);
+    }
+}
+
+void Timings::Record() const {
+    std::lock_guard<std::mutex> guard(statsLock);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        if (count[phase] == 0) continue;
+        PhaseStats &s = stats[phase];
+        s.count++;
+        s.ns += ns[phase];
+        s.bytes += bytes[phase];
+        s.histogram[Bucket(ns[phase])]++;
+    }
+}
+
+TimingsScope::TimingsScope(Timings *timings, bool enabled) : previous(current) {
+    timings->enabled = enabled;
+    current = enabled ? timings : nullptr;
+}
+
+TimingsScope::~TimingsScope() {
+    current = previous;
+}
+
+void Timings::ExportStats(Result *object, bool reset) {
+    PhaseStats copy[PHASE_COUNT];
+    {
+        std::lock_guard<std::mutex> guard(statsLock);
+        std::copy(stats, stats + PHASE_COUNT, copy);
+        if (reset) std::fill(stats, stats + PHASE_COUNT, PhaseStats());
+    }
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        const PhaseStats &s = copy[phase];
+        Result *o = object->SetObject(PHASE_NAMES[phase]);
+        o->SetNumber("count", (double) s.count);
+        o->SetNumber("ns", (double) s.ns);
+        o->SetNumber("bytes", (double) s.bytes);
+        Result *histogram = o->SetArray("histogram", HISTOGRAM_SIZE);
+        for (int i = 0; i < HISTOGRAM_SIZE; i++)
+            histogram->PushNumber((double) s.histogram[i]);
+    }
+}
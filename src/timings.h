@@ -0,0 +1,85 @@
+#ifndef TAGIO_TIMINGS_H
+#define TAGIO_TIMINGS_H
+
+#include <chrono>
+#include <stdint.h>
+
+#include "result.h"
+
+enum Phase {
+    PHASE_OPEN,         // file opened, tags parsed and audio properties scanned by TagLib
+    PHASE_CACHE,        // metadata cache lookup and store
+    PHASE_EXPORT,       // tags converted to Result, includes hash and store
+    PHASE_HASH,         // attachment named by hash of its content
+    PHASE_STORE,        // attachment written to fileDirectory
+    PHASE_SAVE,         // tags written to the file
+    PHASE_MATERIALIZE,  // Result converted to V8 values on the main thread
+    PHASE_COUNT
+};
+
+// Time and bytes spent in each phase of one request (timingsReadable).
+// Worker activates its timings for the thread it runs on, PhaseTimer records
+// to the active timings - when they are disabled the timer costs one thread
+// local load and no clock is read.
+class Timings {
+public:
+    Timings() {}
+
+    bool Enabled() const { return enabled; }
+
+    void Add(Phase phase, uint64_t ns, uint64_t bytes);
+
+    // Phase objects of "timings" of the response - phases which did not run are left out.
+    void Export(Result *object) const;
+
+    // Adds the request to process wide histograms returned by stats().
+    void Record() const;
+
+    // Per phase count, nanoseconds, bytes and histogram of all recorded requests.
+    static void ExportStats(Result *object, bool reset);
+
+    static Timings *Current();
+
+private:
+    friend class TimingsScope;
+
+    bool enabled = false;
+    uint64_t ns[PHASE_COUNT] = {};
+    uint64_t bytes[PHASE_COUNT] = {};
+    uint32_t count[PHASE_COUNT] = {};
+};
+
+// Timings active on the current thread while the scope lives.
+class TimingsScope {
+public:
+    TimingsScope(Timings *timings, bool enabled);
+    ~TimingsScope();
+
+private:
+    Timings *previous;
+};
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase, uint64_t bytes = 0) : timings(Timings::Current()), phase(phase), bytes(bytes) {
+        if (timings != nullptr) start = std::chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer() {
+        if (timings == nullptr) return;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        timings->Add(phase, (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), bytes);
+    }
+
+    // bytes known only at the end of the phase
+    void SetBytes(uint64_t b) { bytes = b; }
+
+private:
+    Timings *timings;
+    Phase phase;
+    uint64_t bytes;
+    std::chrono::steady_clock::time_point start;
+};
+
+
+#endif //TAGIO_TIMINGS_H
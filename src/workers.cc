@@ -0,0 +1,491 @@
+#include "workers.h"
+#include "configuration.h"
+#include "projection.h"
+#include "pool.h"
+#include "materialize.h"
+#include "timings.h"
+#include "tag.h"
+#include "apetag.h"
+#include "id3v1tag.h"
+#include "id3v2tag.h"
+#include "xiphcomment.h"
+#include "flacpicture.h"
+#include "mp4item.h"
+#include "patch.h"
+#include "generic.h"
+#include "mpeg.h"
+#include "flac.h"
+#include "ogg.h"
+#include "mp4.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+using std::string;
+using std::map;
+using std::vector;
+using v8::Function;
+using v8::Local;
+using v8::Value;
+using v8::String;
+using v8::Object;
+using v8::Array;
+using Nan::AsyncWorker;
+using Nan::Callback;
+using Nan::HandleScope;
+using Nan::New;
+using Nan::Null;
+
+// Request state is owned by the worker, the response is built on the pool thread
+// and only materialized in the callback.
+class RequestWorker : public AsyncWorker {
+public:
+    RequestWorker(Callback *callback, string *path, Configuration *conf)
+            : AsyncWorker(callback), path(path), conf(conf) {}
+
+    void Execute () {
+        TimingsScope scope(&timings, conf->TimingsReadable());
+        Run();
+    }
+
+    void HandleOKCallback () {
+        HandleScope scope;
+        Local<Value> argv[] = { Null(), MaterializeTimed(result, timings) };
+        callback->Call(2, argv);
+    }
+
+protected:
+    std::unique_ptr<string> path;
+    std::unique_ptr<Configuration> conf;
+    Result result = Result::Object();
+    Timings timings;
+
+    virtual void Run() = 0;
+};
+
+typedef Reader *(*ReaderFactory)(const string &path, Configuration *conf);
+
+class ReadWorker : public RequestWorker {
+public:
+    ReadWorker(Callback *callback, string *path, Configuration *conf, ReaderFactory factory)
+            : RequestWorker(callback, path, conf), factory(factory) {}
+
+protected:
+    void Run() {
+        // file is closed and the result fully converted before leaving the worker thread
+        std::unique_ptr<Reader> reader(factory(*path, conf.get()));
+        reader->Read(&result);
+    }
+
+private:
+    ReaderFactory factory;
+};
+
+typedef void (*FilePatcher)(const string &path, Configuration *conf, TagPatch *patch, bool verify, Result *result);
+
+class PatchWorker : public RequestWorker {
+public:
+    PatchWorker(Callback *callback, string *path, Configuration *conf, TagPatch *patch, bool verify, FilePatcher patcher)
+            : RequestWorker(callback, path, conf), verify(verify), patch(patch), patcher(patcher) {}
+
+protected:
+    void Run() {
+        patcher(*path, conf.get(), patch.get(), verify, &result);
+    }
+
+private:
+    bool verify;
+    std::unique_ptr<TagPatch> patch;
+    FilePatcher patcher;
+};
+
+class MPEGWriteWorker : public RequestWorker {
+public:
+    MPEGWriteWorker(Callback *callback, string *path, Configuration *conf,
+                    TagLib::ID3v1::Tag *id3v1Tag,
+                    TagLib::ID3v2::Tag *id3v2Tag,
+                    TagLib::APE::Tag *apeTag,
+                    map<uintptr_t, string> *fmap,
+                    bool verify)
+            : RequestWorker(callback, path, conf),
+              verify(verify),
+              id3v1Tag(id3v1Tag),
+              id3v2Tag(id3v2Tag),
+              apeTag(apeTag),
+              fmap(fmap) {}
+
+protected:
+    void Run() {
+        WriteMPEGFile(*path, conf.get(), id3v1Tag.get(), id3v2Tag.get(), apeTag.get(), *fmap, verify, &result);
+    }
+
+private:
+    bool verify;
+    std::unique_ptr<TagLib::ID3v1::Tag> id3v1Tag;
+    std::unique_ptr<TagLib::ID3v2::Tag> id3v2Tag;
+    std::unique_ptr<TagLib::APE::Tag> apeTag;
+    std::unique_ptr<map<uintptr_t, string>> fmap;
+};
+
+class FLACWriteWorker : public RequestWorker {
+public:
+    FLACWriteWorker(Callback *callback, string *path, Configuration *conf,
+                    TagLib::ID3v1::Tag *id3v1Tag,
+                    TagLib::ID3v2::Tag *id3v2Tag,
+                    TagLib::Ogg::XiphComment *xiphComment,
+                    vector<TagLib::FLAC::Picture *> *pictures,
+                    map<uintptr_t, string> *fmap,
+                    bool verify)
+            : RequestWorker(callback, path, conf),
+              verify(verify),
+              id3v1Tag(id3v1Tag),
+              id3v2Tag(id3v2Tag),
+              xiphComment(xiphComment),
+              pictures(pictures),
+              fmap(fmap) {}
+
+    // pictures not added to the file are deleted
+    ~FLACWriteWorker() {
+        if (pictures != nullptr) {
+            for (auto picture : *pictures) delete picture;
+        }
+    }
+
+protected:
+    void Run() {
+        WriteFLACFile(*path, conf.get(), id3v1Tag.get(), id3v2Tag.get(), xiphComment.get(), pictures.get(), *fmap,
+                      verify, &result);
+    }
+
+private:
+    bool verify;
+    std::unique_ptr<TagLib::ID3v1::Tag> id3v1Tag;
+    std::unique_ptr<TagLib::ID3v2::Tag> id3v2Tag;
+    std::unique_ptr<TagLib::Ogg::XiphComment> xiphComment;
+    std::unique_ptr<vector<TagLib::FLAC::Picture *>> pictures;
+    std::unique_ptr<map<uintptr_t, string>> fmap;
+};
+
+class OggWriteWorker : public RequestWorker {
+public:
+    OggWriteWorker(Callback *callback, string *path, Configuration *conf, TagLib::Ogg::XiphComment *xiphComment, bool verify)
+            : RequestWorker(callback, path, conf), verify(verify), xiphComment(xiphComment) {}
+
+protected:
+    void Run() {
+        WriteOggFile(*path, conf.get(), xiphComment.get(), verify, &result);
+    }
+
+private:
+    bool verify;
+    std::unique_ptr<TagLib::Ogg::XiphComment> xiphComment;
+};
+
+class MP4WriteWorker : public RequestWorker {
+public:
+    MP4WriteWorker(Callback *callback, string *path, Configuration *conf, MP4Items *items, bool verify)
+            : RequestWorker(callback, path, conf), verify(verify), items(items) {}
+
+protected:
+    void Run() {
+        WriteMP4File(*path, conf.get(), items.get(), verify, &result);
+    }
+
+private:
+    bool verify;
+    // without items the file keeps its ones
+    std::unique_ptr<MP4Items> items;
+};
+
+class GenericWriteWorker : public RequestWorker {
+public:
+    GenericWriteWorker(Callback *callback, string *path, Configuration *conf, GenericTag *gtag, bool verify)
+            : RequestWorker(callback, path, conf), verify(verify), gtag(gtag) {}
+
+protected:
+    void Run() {
+        WriteGenericFile(*path, conf.get(), *gtag, verify, &result);
+    }
+
+private:
+    bool verify;
+    std::unique_ptr<GenericTag> gtag;
+};
+
+static string *ImportPath(Object *reqObj) {
+    Local<String> pathKey = New<String>("path").ToLocalChecked();
+    Local<String> pathObj = reqObj->Get(pathKey).As<String>();
+    String::Utf8Value pathVal(pathObj);
+    return new string(*pathVal);
+}
+
+// Configuration of write and patch requests is optional.
+static Configuration *ImportWriteConfiguration(Object *reqObj) {
+    Configuration *conf = new Configuration();
+    Local<String> confKey = New<String>("configuration").ToLocalChecked();
+    if (reqObj->Has(confKey)) {
+        Local<Object> confVal = reqObj->Get(confKey).As<Object>();
+        ImportConfiguration(*confVal, conf);
+    }
+    return conf;
+}
+
+static bool ImportVerify(Object *reqObj) {
+    Local<String> verifyKey = New<String>("verify").ToLocalChecked();
+    return reqObj->Has(verifyKey) && reqObj->Get(verifyKey)->BooleanValue();
+}
+
+static void QueueRead(NAN_METHOD_ARGS_TYPE info, ReaderFactory factory) {
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    string *path = ImportPath(*reqObj);
+
+    Local<String> confKey = New<String>("configuration").ToLocalChecked();
+    Local<Object> confVal = reqObj->Get(confKey).As<Object>();
+    Configuration *conf = new Configuration();
+    ImportConfiguration(*confVal, conf);
+
+    Local<String> fieldsKey = New<String>("fields").ToLocalChecked();
+    if (reqObj->Has(fieldsKey)) {
+        Local<Array> fieldsVal = reqObj->Get(fieldsKey).As<Array>();
+        ImportProjection(*fieldsVal, &conf->Fields());
+    }
+
+    PoolQueueWorker(new ReadWorker(callback, path, conf, factory), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(ReadGeneric) {
+    QueueRead(info, NewGenericReader);
+}
+
+NAN_METHOD(WriteGeneric) {
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    string *path = ImportPath(*reqObj);
+
+    Local<String> confKey = New<String>("configuration").ToLocalChecked();
+    Local<Object> confVal = reqObj->Get(confKey).As<Object>();
+    Configuration *conf = new Configuration();
+    ImportConfiguration(*confVal, conf);
+
+    Local<String> tagKey = New<String>("tag").ToLocalChecked();
+    Local<Object> tagVal = reqObj->Get(tagKey).As<Object>();
+    GenericTag *gtag = new GenericTag();
+    ImportTag(*tagVal, gtag);
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new GenericWriteWorker(callback, path, conf, gtag, verify), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(ReadMPEG) {
+    QueueRead(info, NewMPEGReader);
+}
+
+NAN_METHOD(WriteMPEG) {
+    TagLib::ID3v1::Tag *id3v1Tag = new TagLib::ID3v1::Tag();
+    TagLib::ID3v2::Tag *id3v2Tag = new TagLib::ID3v2::Tag();
+    TagLib::APE::Tag *apeTag = new TagLib::APE::Tag();
+    map<uintptr_t, string> *fmap = new map<uintptr_t, string>();
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> id3v1Key = New<String>("id3v1").ToLocalChecked();
+    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
+    Local<String> apeKey = New<String>("ape").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    if (conf->ID3v1Writable() && reqObj->Has(id3v1Key)) {
+        Local<Object> id3v1Val = reqObj->Get(id3v1Key).As<Object>();
+        ImportID3v1Tag(*id3v1Val, id3v1Tag, conf);
+    }
+
+    if (conf->ID3v2Writable() && reqObj->Has(id3v2Key)) {
+        Local<Array> id3v2Val = reqObj->Get(id3v2Key).As<Array>();
+        ImportID3v2Tag(*id3v2Val, id3v2Tag, fmap, conf);
+    }
+
+    if (conf->APEWritable() && reqObj->Has(apeKey)) {
+        Local<Object> apeVal = reqObj->Get(apeKey).As<Object>();
+        ImportAPETag(*apeVal, apeTag);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new MPEGWriteWorker(callback, path, conf, id3v1Tag, id3v2Tag, apeTag, fmap, verify), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(PatchMPEG) {
+    TagPatch *patch = new TagPatch();
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    if (conf->ID3v2Writable() && reqObj->Has(id3v2Key)) {
+        Local<Array> id3v2Val = reqObj->Get(id3v2Key).As<Array>();
+        patch->ImportID3v2(*id3v2Val, conf);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new PatchWorker(callback, path, conf, patch, verify, PatchMPEGFile), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(ReadFLAC) {
+    QueueRead(info, NewFLACReader);
+}
+
+NAN_METHOD(WriteFLAC) {
+    TagLib::ID3v1::Tag *id3v1Tag = new TagLib::ID3v1::Tag();
+    TagLib::ID3v2::Tag *id3v2Tag = new TagLib::ID3v2::Tag();
+    TagLib::Ogg::XiphComment *xiphComment = new TagLib::Ogg::XiphComment();
+    vector<TagLib::FLAC::Picture *> *pictures = nullptr;
+    map<uintptr_t, string> *fmap = new map<uintptr_t, string>();
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> id3v1Key = New<String>("id3v1").ToLocalChecked();
+    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
+    Local<String> xiphCommentKey = New<String>("xiphComment").ToLocalChecked();
+    Local<String> picturesKey = New<String>("pictures").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    if (conf->ID3v1Writable() && reqObj->Has(id3v1Key)) {
+        Local<Object> id3v1Val = reqObj->Get(id3v1Key).As<Object>();
+        ImportID3v1Tag(*id3v1Val, id3v1Tag, conf);
+    }
+
+    if (conf->ID3v2Writable() && reqObj->Has(id3v2Key)) {
+        Local<Array> id3v2Val = reqObj->Get(id3v2Key).As<Array>();
+        ImportID3v2Tag(*id3v2Val, id3v2Tag, fmap, conf);
+    }
+
+    if (conf->XIPHCommentWritable() && reqObj->Has(xiphCommentKey)) {
+        Local<Array> xiphCommentVal = reqObj->Get(xiphCommentKey).As<Array>();
+        ImportXiphComment(*xiphCommentVal, xiphComment);
+    }
+
+    if (conf->XIPHCommentWritable() && reqObj->Has(picturesKey)) {
+        Local<Array> picturesVal = reqObj->Get(picturesKey).As<Array>();
+        pictures = new vector<TagLib::FLAC::Picture *>();
+        ImportFLACPictures(*picturesVal, pictures, fmap);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new FLACWriteWorker(callback, path, conf, id3v1Tag, id3v2Tag, xiphComment, pictures, fmap, verify), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(PatchFLAC) {
+    TagPatch *patch = new TagPatch();
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> id3v2Key = New<String>("id3v2").ToLocalChecked();
+    Local<String> xiphCommentKey = New<String>("xiphComment").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    if (conf->ID3v2Writable() && reqObj->Has(id3v2Key)) {
+        Local<Array> id3v2Val = reqObj->Get(id3v2Key).As<Array>();
+        patch->ImportID3v2(*id3v2Val, conf);
+    }
+
+    if (conf->XIPHCommentWritable() && reqObj->Has(xiphCommentKey)) {
+        Local<Array> xiphCommentVal = reqObj->Get(xiphCommentKey).As<Array>();
+        patch->ImportXiphComment(*xiphCommentVal);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new PatchWorker(callback, path, conf, patch, verify, PatchFLACFile), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(ReadOgg) {
+    QueueRead(info, NewOggReader);
+}
+
+NAN_METHOD(WriteOgg) {
+    TagLib::Ogg::XiphComment *xiphComment = new TagLib::Ogg::XiphComment();
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> xiphCommentKey = New<String>("xiphComment").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    if (conf->XIPHCommentWritable() && reqObj->Has(xiphCommentKey)) {
+        Local<Array> xiphCommentVal = reqObj->Get(xiphCommentKey).As<Array>();
+        ImportXiphComment(*xiphCommentVal, xiphComment);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new OggWriteWorker(callback, path, conf, xiphComment, verify), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(PatchOgg) {
+    TagPatch *patch = new TagPatch();
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> xiphCommentKey = New<String>("xiphComment").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    if (conf->XIPHCommentWritable() && reqObj->Has(xiphCommentKey)) {
+        Local<Array> xiphCommentVal = reqObj->Get(xiphCommentKey).As<Array>();
+        patch->ImportXiphComment(*xiphCommentVal);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new PatchWorker(callback, path, conf, patch, verify, PatchOggFile), RequestPriority(*reqObj));
+}
+
+NAN_METHOD(ReadMP4) {
+    QueueRead(info, NewMP4Reader);
+}
+
+NAN_METHOD(WriteMP4) {
+    MP4Items *items = nullptr;
+
+    Local<Object> reqObj = info[0].As<Object>();
+    Callback *callback = new Callback(info[1].As<Function>());
+
+    Local<String> mp4Key = New<String>("mp4").ToLocalChecked();
+
+    string *path = ImportPath(*reqObj);
+    Configuration *conf = ImportWriteConfiguration(*reqObj);
+
+    // without mp4 the items are kept as they are
+    if (conf->MP4Writable() && reqObj->Has(mp4Key)) {
+        Local<Array> mp4Val = reqObj->Get(mp4Key).As<Array>();
+        items = new MP4Items();
+        items->Import(*mp4Val);
+    }
+
+    bool verify = ImportVerify(*reqObj);
+
+    PoolQueueWorker(new MP4WriteWorker(callback, path, conf, items, verify), RequestPriority(*reqObj));
+}
@@ -0,0 +1,28 @@
+#ifndef TAGIO_WORKERS_H
+#define TAGIO_WORKERS_H
+
+#include <nan.h>
+
+// Single file requests - the request is imported on the main thread, read or
+// written by the format functions (mpeg.h, flac.h, ogg.h, mp4.h, generic.h) on
+// a pool thread and materialized back on the main thread.
+
+NAN_METHOD(ReadGeneric);
+NAN_METHOD(WriteGeneric);
+
+NAN_METHOD(ReadMPEG);
+NAN_METHOD(WriteMPEG);
+NAN_METHOD(PatchMPEG);
+
+NAN_METHOD(ReadFLAC);
+NAN_METHOD(WriteFLAC);
+NAN_METHOD(PatchFLAC);
+
+NAN_METHOD(ReadOgg);
+NAN_METHOD(WriteOgg);
+NAN_METHOD(PatchOgg);
+
+NAN_METHOD(ReadMP4);
+NAN_METHOD(WriteMP4);
+
+#endif //TAGIO_WORKERS_H
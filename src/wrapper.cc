@@ -1,102 +1,47 @@
 #include "wrapper.h"
 
 
-using namespace v8;
 using namespace std;
-using Nan::New;
 
 
-TagLibWrapper::TagLibWrapper(Object *object) : object(object) {}
+TagLibWrapper::TagLibWrapper(Result *result) : result(result) {}
 
 TagLibWrapper::~TagLibWrapper() {}
 
-bool TagLibWrapper::GetBoolean(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        return object->Get(New<String>(key).ToLocalChecked())->BooleanValue();
-    } else {
-        return false;
-    }
-}
-
 void TagLibWrapper::SetBoolean(const char *key, bool value) {
-    object->Set(New<String>(key).ToLocalChecked(), New<Boolean>(value));
-}
-
-double TagLibWrapper::GetNumber(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        return object->Get(New<String>(key).ToLocalChecked())->NumberValue();
-    } else {
-        return 0.0;
-    }
+    result->SetBoolean(key, value);
 }
 
 void TagLibWrapper::SetNumber(const char *key, double value) {
-    object->Set(New<String>(key).ToLocalChecked(), New<Number>(value));
-}
-
-int TagLibWrapper::GetInt32(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        return (int) (object->Get(New<String>(key).ToLocalChecked()))->Int32Value();
-    } else {
-        return 0;
-    }
+    result->SetNumber(key, value);
 }
 
 void TagLibWrapper::SetInt32(const char *key, int value) {
-    object->Set(New<String>(key).ToLocalChecked(), New<Integer>(value));
-}
-
-TagLib::uint TagLibWrapper::GetUint32(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        return (TagLib::uint) (object->Get(New<String>(key).ToLocalChecked()))->Uint32Value();
-    } else {
-        return 0;
-    }
+    result->SetNumber(key, value);
 }
 
 void TagLibWrapper::SetUint32(const char *key, const TagLib::uint value) {
-    object->Set(New<String>(key).ToLocalChecked(), New<Integer>(value));
-}
-
-TagLib::String TagLibWrapper::GetString(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        String::Utf8Value value(object->Get(keyString));
-        return TagLib::String(*value, TagLib::String::UTF8);
-    } else {
-        return TagLib::String::null;
-    }
+    result->SetNumber(key, value);
 }
 
 void TagLibWrapper::SetString(const char *key, TagLib::String value) {
-    object->Set(New<String>(key).ToLocalChecked(), New<String>(value.toCString(true)).ToLocalChecked());
-}
-
-TagLib::StringList TagLibWrapper::GetStringList(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    Local<Array> array = Local<Array>::Cast(object->Get(keyString));
-    TagLib::StringList list;
-    //cout << "LENGTH" << array->Length() << endl;
-    if (object->Has(keyString)) {
-       for (uint32_t i = 0; i < array->Length(); i++) {
-           String::Utf8Value value(array->Get(i)->ToString());
-           TagLib::String string(*value, TagLib::String::UTF8);
-           list.append(string);
-       }
-    }
-    return list;
+    result->SetString(key, value.toCString(true));
 }
 
 void TagLibWrapper::SetStringList(const char *key, TagLib::StringList value) {
-    Local<Array> array = New<Array>(value.size());
+    Result *array = result->SetArray(key, value.size());
     for (uint32_t i = 0; i < value.size(); i++) {
-        array->Set(i, New<String>(value[i].toCString(true)).ToLocalChecked());
+        array->PushString(value[i].toCString(true));
     }
-    object->Set(New<String>(key).ToLocalChecked(), array);
+}
+
+// Buffer shares data with the byte vector - no bytes are copied.
+void TagLibWrapper::SetBuffer(const char *key, const TagLib::ByteVector value) {
+    result->SetBuffer(key, value);
+}
+
+Result *TagLibWrapper::SetObject(const char *key) {
+    return result->SetObject(key);
 }
 
 //TagLib::ByteVector TagLibWrapper::GetBytes(const char *key, std::map<uintptr_t, std::string> *fmap) {
@@ -113,24 +58,8 @@ void TagLibWrapper::SetStringList(const char *key, TagLib::StringList value) {
 //    SetString(key, ByteVector::Export(value, mimeType));
 //}
 
-TagLib::String::Type TagLibWrapper::GetEncoding(const char *key) {
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        String::Utf8Value value(object->Get(keyString));
-        TagLib::String encodingString(*value, TagLib::String::UTF8);
-        if (encodingString == "Latin1") return TagLib::String::Latin1;
-        else if (encodingString == "UTF8") return TagLib::String::UTF8;
-        else if (encodingString == "UTF16") return TagLib::String::UTF16;
-        else if (encodingString == "UTF16BE") return TagLib::String::UTF16BE;
-        else if (encodingString == "UTF16LE") return TagLib::String::UTF16LE;
-        else return TagLib::String::UTF16;
-    } else {
-        return TagLib::String::UTF16;
-    }
-}
-
 void TagLibWrapper::SetEncoding(const char *key, const TagLib::String::Type value) {
-    string enc;
+    const char *enc;
     switch (value) {
         case TagLib::String::Latin1:
             enc = "Latin1";
@@ -151,27 +80,14 @@ void TagLibWrapper::SetEncoding(const char *key, const TagLib::String::Type valu
             enc = "UTF16";
 
     }
-    object->Set(New<String>(key).ToLocalChecked(), New<String>(enc.c_str()).ToLocalChecked());
-}
-
-TagLib::ByteVector TagLibWrapper::GetLanguage(const char *key) {
-    //TODO: Check valid ISO format
-    //TODO: Find better transoform from ByteVector to char *
-    Local<String> keyString = New<String>(key).ToLocalChecked();
-    if (object->Has(keyString)) {
-        String::Utf8Value value(object->Get(keyString));
-        TagLib::String str(*value);
-        return TagLib::ByteVector(str.toCString(), str.size());
-    } else {
-        return TagLib::ByteVector();
-    }
+    result->SetString(key, enc);
 }
 
 void TagLibWrapper::SetLanguage(const char *key, const TagLib::ByteVector value) {
     //TODO: Check valid ISO format
     //TODO: Find better transform from ByteVector to char *
     TagLib::String str(value);
-    object->Set(New<String>(key).ToLocalChecked(), New<String>(str.toCString(true)).ToLocalChecked());
+    result->SetString(key, str.toCString(true));
 }
 
 
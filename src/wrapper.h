@@ -2,15 +2,17 @@
 #define TAGIO_WRAPPER_H
 
 
-#include <nan.h>
 #include <string>
 #include <taglib/tlist.h>
 #include <taglib/tstring.h>
 #include <taglib/tstringlist.h>
 #include <taglib/tbytevector.h>
 #include "md5.h"
+#include "result.h"
 
 // Wrap v8 object and convert properties for taglib.
+// Getters read the v8 object (import, main thread, defined in import.cc),
+// setters build the result (export, worker thread).
 
 
 
@@ -18,6 +20,7 @@ class TagLibWrapper {
 
 public:
     TagLibWrapper(v8::Object *object);
+    TagLibWrapper(Result *result);
     bool GetBoolean(const char *key);
     void SetBoolean(const char *key, bool value);
     double GetNumber (const char *key);
@@ -32,6 +35,10 @@ public:
     void SetStringList(const char *key, const TagLib::StringList value);
 //        TagLib::List<TagLib::String> GetStringArray(const char *key);
 //        void SetStringArray(const char *key, const TagLib::List<TagLib::String>);
+    bool IsBuffer(const char *key);
+    TagLib::ByteVector GetBuffer(const char *key);
+    void SetBuffer(const char *key, const TagLib::ByteVector value);
+    Result *SetObject(const char *key);
     //TagLib::ByteVector GetBytes(const char *key);
     //void SetBytes(const char *key, const TagLib::ByteVector value, TagLib::String mimeType);
     TagLib::String::Type GetEncoding(const char *key);
@@ -40,7 +47,8 @@ public:
     void SetLanguage(const char *key, const TagLib::ByteVector value);
     ~TagLibWrapper();
 private:
-    v8::Object *object;
+    v8::Object *object = nullptr;
+    Result *result = nullptr;
 };
 
 
@@ -1,11 +1,12 @@
 #ifndef TAGIO_XIPH_COMMENT_H
 #define TAGIO_XIPH_COMMENT_H
 
-#include <nan.h>
 #include <taglib/xiphcomment.h>
+#include "result.h"
+#include "projection.h"
 
 void ClearXiphComment(TagLib::Ogg::XiphComment *tag);
-void ExportXiphComment(TagLib::Ogg::XiphComment *tag, v8::Array *array);
+void ExportXiphComment(TagLib::Ogg::XiphComment *tag, Result *array, const Projection &fields);
 void ImportXiphComment(v8::Array *array, TagLib::Ogg::XiphComment *tag);
 
 #endif //TAGIO_XIPH_COMMENT_H
@@ -0,0 +1,260 @@
+//
+//  xxh3.cc
+//  TagIO
+//
+//  Port of XXH3_64bits from xxHash (BSD 2-Clause, Copyright (C) Yann Collet).
+//
+
+#include "xxh3.h"
+
+#include <stdio.h>
+
+
+typedef uint8_t  u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+static const u32 PRIME32_1 = 0x9E3779B1U;
+static const u32 PRIME32_2 = 0x85EBCA77U;
+static const u32 PRIME32_3 = 0xC2B2AE3DU;
+
+static const u64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const u64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const u64 PRIME64_3 = 0x165667B19E3779F9ULL;
+static const u64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const u64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static const u64 PRIME_MX1 = 0x165667919E3779F9ULL;
+static const u64 PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+static const size_t STRIPE_LEN = 64;
+static const size_t SECRET_CONSUME_RATE = 8;
+static const size_t ACC_NB = STRIPE_LEN / sizeof(u64);
+static const size_t SECRET_SIZE = 192;
+static const size_t SECRET_LASTACC_START = 7;
+static const size_t SECRET_MERGEACCS_START = 11;
+static const size_t MIDSIZE_MAX = 240;
+static const size_t MIDSIZE_STARTOFFSET = 3;
+static const size_t MIDSIZE_LASTOFFSET = 17;
+static const size_t SECRET_SIZE_MIN = 136;
+
+static const u8 SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+///////////////////////////////////////////////
+
+// Little endian reads - compilers turn these into plain loads.
+static inline u32 read32(const u8 *p) {
+    return (u32) p[0] | ((u32) p[1] << 8) | ((u32) p[2] << 16) | ((u32) p[3] << 24);
+}
+
+static inline u64 read64(const u8 *p) {
+    return (u64) read32(p) | ((u64) read32(p + 4) << 32);
+}
+
+static inline u32 swap32(u32 x) {
+    return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) |
+           ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+static inline u64 swap64(u64 x) {
+    return ((u64) swap32((u32) x) << 32) | (u64) swap32((u32) (x >> 32));
+}
+
+static inline u64 rotl64(u64 x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// 64x64 -> 128 bit multiplication folded to 64 bits (low ^ high)
+static inline u64 mul128_fold64(u64 lhs, u64 rhs) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = (__uint128_t) lhs * rhs;
+    return (u64) product ^ (u64) (product >> 64);
+#else
+    u64 lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+    u64 hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+    u64 lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+    u64 hi_hi = (lhs >> 32) * (rhs >> 32);
+    u64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    u64 upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    u64 lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+static inline u64 xxh64_avalanche(u64 h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline u64 avalanche(u64 h) {
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline u64 rrmxmx(u64 h, u64 length) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + length;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline u64 mix16B(const u8 *input, const u8 *secret) {
+    return mul128_fold64(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+///////////////////////////////////////////////
+
+static inline u64 len_1to3(const u8 *input, size_t length) {
+    u8 c1 = input[0];
+    u8 c2 = input[length >> 1];
+    u8 c3 = input[length - 1];
+    u32 combined = ((u32) c1 << 16) | ((u32) c2 << 24) | ((u32) c3 << 0) | ((u32) length << 8);
+    u64 bitflip = (u64) (read32(SECRET) ^ read32(SECRET + 4));
+    return xxh64_avalanche((u64) combined ^ bitflip);
+}
+
+static inline u64 len_4to8(const u8 *input, size_t length) {
+    u32 input1 = read32(input);
+    u32 input2 = read32(input + length - 4);
+    u64 bitflip = read64(SECRET + 8) ^ read64(SECRET + 16);
+    u64 input64 = input2 + ((u64) input1 << 32);
+    return rrmxmx(input64 ^ bitflip, length);
+}
+
+static inline u64 len_9to16(const u8 *input, size_t length) {
+    u64 bitflip1 = read64(SECRET + 24) ^ read64(SECRET + 32);
+    u64 bitflip2 = read64(SECRET + 40) ^ read64(SECRET + 48);
+    u64 lo = read64(input) ^ bitflip1;
+    u64 hi = read64(input + length - 8) ^ bitflip2;
+    u64 acc = length + swap64(lo) + hi + mul128_fold64(lo, hi);
+    return avalanche(acc);
+}
+
+static inline u64 len_0to16(const u8 *input, size_t length) {
+    if (length > 8) return len_9to16(input, length);
+    if (length >= 4) return len_4to8(input, length);
+    if (length > 0) return len_1to3(input, length);
+    return xxh64_avalanche(read64(SECRET + 56) ^ read64(SECRET + 64));
+}
+
+static inline u64 len_17to128(const u8 *input, size_t length) {
+    u64 acc = length * PRIME64_1;
+    if (length > 32) {
+        if (length > 64) {
+            if (length > 96) {
+                acc += mix16B(input + 48, SECRET + 96);
+                acc += mix16B(input + length - 64, SECRET + 112);
+            }
+            acc += mix16B(input + 32, SECRET + 64);
+            acc += mix16B(input + length - 48, SECRET + 80);
+        }
+        acc += mix16B(input + 16, SECRET + 32);
+        acc += mix16B(input + length - 32, SECRET + 48);
+    }
+    acc += mix16B(input + 0, SECRET + 0);
+    acc += mix16B(input + length - 16, SECRET + 16);
+    return avalanche(acc);
+}
+
+static inline u64 len_129to240(const u8 *input, size_t length) {
+    u64 acc = length * PRIME64_1;
+    size_t rounds = length / 16;
+    for (size_t i = 0; i < 8; i++)
+        acc += mix16B(input + 16 * i, SECRET + 16 * i);
+    acc = avalanche(acc);
+    for (size_t i = 8; i < rounds; i++)
+        acc += mix16B(input + 16 * i, SECRET + 16 * (i - 8) + MIDSIZE_STARTOFFSET);
+    acc += mix16B(input + length - 16, SECRET + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET);
+    return avalanche(acc);
+}
+
+///////////////////////////////////////////////
+
+// One 64 byte stripe - lanes are independent, loop is vectorized.
+static inline void accumulate_512(u64 acc[ACC_NB], const u8 *input, const u8 *secret) {
+    for (size_t i = 0; i < ACC_NB; i++) {
+        u64 value = read64(input + 8 * i);
+        u64 key = value ^ read64(secret + 8 * i);
+        acc[i ^ 1] += value;
+        acc[i] += (u64) (u32) key * (key >> 32);
+    }
+}
+
+static inline void accumulate(u64 acc[ACC_NB], const u8 *input, const u8 *secret, size_t stripes) {
+    for (size_t n = 0; n < stripes; n++)
+        accumulate_512(acc, input + n * STRIPE_LEN, secret + n * SECRET_CONSUME_RATE);
+}
+
+static inline void scramble(u64 acc[ACC_NB], const u8 *secret) {
+    for (size_t i = 0; i < ACC_NB; i++) {
+        u64 a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        a *= PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+static inline u64 merge(const u64 acc[ACC_NB], const u8 *secret, u64 start) {
+    u64 result = start;
+    for (size_t i = 0; i < 4; i++)
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i), acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    return avalanche(result);
+}
+
+static u64 len_long(const u8 *input, size_t length) {
+    u64 acc[ACC_NB] = { PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1 };
+    const size_t stripesPerBlock = (SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE;
+    const size_t blockLength = STRIPE_LEN * stripesPerBlock;
+    const size_t blocks = (length - 1) / blockLength;
+
+    for (size_t n = 0; n < blocks; n++) {
+        accumulate(acc, input + n * blockLength, SECRET, stripesPerBlock);
+        scramble(acc, SECRET + SECRET_SIZE - STRIPE_LEN);
+    }
+
+    // last partial block
+    size_t stripes = ((length - 1) - blockLength * blocks) / STRIPE_LEN;
+    accumulate(acc, input + blocks * blockLength, SECRET, stripes);
+
+    // last stripe
+    accumulate_512(acc, input + length - STRIPE_LEN, SECRET + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC_START);
+
+    return merge(acc, SECRET + SECRET_MERGEACCS_START, (u64) length * PRIME64_1);
+}
+
+///////////////////////////////////////////////
+
+uint64_t XXH3_64bits(const void *data, size_t length) {
+    const u8 *input = static_cast<const u8 *>(data);
+    if (length <= 16) return len_0to16(input, length);
+    if (length <= 128) return len_17to128(input, length);
+    if (length <= MIDSIZE_MAX) return len_129to240(input, length);
+    return len_long(input, length);
+}
+
+std::string xxh3(const char *data, size_t length) {
+    char buf[17];
+    snprintf(buf, sizeof buf, "%016llx", (unsigned long long) XXH3_64bits(data, length));
+    return std::string(buf);
+}
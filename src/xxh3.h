@@ -0,0 +1,27 @@
+//
+//  xxh3.h
+//  TagIO
+//
+
+#ifndef TAGIO_XXH3
+#define TAGIO_XXH3
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+
+// XXH3 64-bit hash (seed 0, default secret) - fast non-cryptographic hash
+// compatible with the reference xxHash implementation.
+// Long inputs are processed in 8 independent 64-bit lanes, the inner loop is
+// written to be auto-vectorized by the compiler (SSE2/AVX2/NEON).
+//
+// usage: xxh3(data, length) -> 16 characters long hex digest
+
+uint64_t XXH3_64bits(const void *data, size_t length);
+
+std::string xxh3(const char *data, size_t length);
+
+
+#endif // TAGIO_XXH3
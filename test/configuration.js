@@ -35,10 +35,15 @@ describe("Configuration", function() {
         const conf = {
             fileExtracted: tagio.FileExtracted.IS_IGNORED,
                 fileDirectory: os.tmpdir(),
+                fileHash: tagio.FileHash.MD5,
                 fileUrlPrefix: "/something",
+                cacheDirectory: "",
+                importCacheSize: 1048576,
                 configurationReadable: true,
                 audioPropertiesReadable: true,
+                audioPropertiesStyle: tagio.AudioPropertiesStyle.ACCURATE,
                 tagReadable: true,
+                timingsReadable: false,
                 apeWritable: false,
                 apeReadable: false,
                 id3v1Writable: false,
@@ -49,8 +54,15 @@ describe("Configuration", function() {
                 id3v2Encoding: tagio.Encoding.UTF16BE,
                 id3v2Version: 3,
                 id3v2UseFrameEncoding: false,
+                id3v2Padding: 1024,
                 xiphCommentReadable: true,
-                xiphCommentWritable: true
+                xiphCommentWritable: true,
+                xiphCommentPadding: 512,
+                mp4Readable: false,
+                mp4Writable: false,
+                threads: 2,
+                queueSize: 64,
+                queueLimit: 128
         };
         const req = {
             path: testFile
@@ -132,4 +132,36 @@ describe("FLAC", function() {
         }).catch(function(err) { done(err); });
     });
 
+    it("Write and read pictures", function(done) {
+        const picture = fs.readFileSync(testJPEG);
+        const req = {
+            path: testFile,
+            configuration: {
+                fileExtracted: tagio.FileExtracted.AS_BUFFER
+            },
+            pictures: [
+                {type: 3, mimeType: "image/jpeg", description: "Cover", width: 1, height: 1, colorDepth: 24, numColors: 0, picture: testJPEG}
+            ]
+        };
+        tagio.write(req).then(function (res) {
+            assert.equal(res.pictures.length, 1);
+            assert.equal(res.pictures[0].type, 3);
+            assert.equal(res.pictures[0].mimeType, "image/jpeg");
+            assert.equal(res.pictures[0].description, "Cover");
+            assert.isTrue(picture.equals(res.pictures[0].picture));
+            return tagio.read({
+                path: testFile,
+                configuration: { fileExtracted: tagio.FileExtracted.AS_HANDLE }
+            });
+        }).then(function (res) {
+            const attachment = res.pictures[0].picture;
+            assert.instanceOf(attachment, tagio.Attachment);
+            assert.equal(attachment.length, picture.length);
+            return attachment.load();
+        }).then(function (data) {
+            assert.isTrue(picture.equals(data));
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
 });
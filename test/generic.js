@@ -50,6 +50,86 @@ describe("WAV (generic tag)", function() {
         }).catch(function(err) { done(err); });
     });
 
+    it("read tag only", function (done) {
+        const req = {
+            path: testFile,
+            configuration: {
+                audioPropertiesReadable: false,
+                tagReadable: true
+            }
+        };
+        tagio.read(req).then(function (res) {
+            assert.isUndefined(res.error);
+            assert.isUndefined(res.audioProperties);
+            assert.isObject(res.tag);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("read fast audio properties", function (done) {
+        const req = {
+            path: testFile,
+            configuration: {
+                audioPropertiesReadable: true,
+                audioPropertiesStyle: tagio.AudioPropertiesStyle.FAST,
+                tagReadable: true
+            }
+        };
+        tagio.read(req).then(function (res) {
+            assert.isObject(res.audioProperties);
+            assert.isAbove(res.audioProperties.sampleRate, 0);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("read through metadata cache", function (done) {
+        var cacheDir = path.resolve(testDir, "cache");
+        if (!fs.existsSync(cacheDir)) fs.mkdirSync(cacheDir);
+        var conf = {
+            cacheDirectory: cacheDir,
+            audioPropertiesReadable: true,
+            tagReadable: true
+        };
+        var first;
+        tagio.read({ path: testFile, configuration: conf }).then(function (res) {
+            first = res;
+            return tagio.read({ path: testFile, configuration: conf });
+        }).then(function (res) {
+            assert.deepEqual(res, first);
+            return tagio.write({ path: testFile, configuration: conf, tag: {
+                "title": "Cached Title", "album": "", "artist": "", "track": 0, "year": 0, "genre": "", "comment": ""
+            }});
+        }).then(function () {
+            return tagio.read({ path: testFile, configuration: conf });
+        }).then(function (res) {
+            assert.equal(res.path, testFile);
+            assert.equal(res.tag.title, "Cached Title");
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("read through metadata cache returns configuration of the request", function (done) {
+        var cacheDir = path.resolve(testDir, "cache");
+        if (!fs.existsSync(cacheDir)) fs.mkdirSync(cacheDir);
+        var conf = function (padding) {
+            return {
+                cacheDirectory: cacheDir,
+                configurationReadable: true,
+                id3v2Padding: padding
+            };
+        };
+        tagio.read({ path: testFile, configuration: conf(1024) }).then(function (res) {
+            assert.equal(res.configuration.id3v2Padding, 1024);
+            return tagio.read({ path: testFile, configuration: conf(2048) });
+        }).then(function (res) {
+            // write option does not change the key, the entry is shared
+            assert.equal(res.configuration.id3v2Padding, 2048);
+            assert.equal(res.path, testFile);
+            assert.isObject(res.tag);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
     it("write", function (done) {
         const req = {
             path: testFile,
@@ -0,0 +1,64 @@
+// Minimal M4A file - moov before mdat (as optimized for streaming), so a growing
+// tag moves the audio data and the chunk offset in stco has to follow it.
+
+var AUDIO = Buffer.from("TAGIO-AUDIO-DATA", "latin1");
+
+var atom = function (name) {
+    var body = Buffer.concat(Array.prototype.slice.call(arguments, 1));
+    var header = Buffer.alloc(8);
+    header.writeUInt32BE(8 + body.length, 0);
+    header.write(name, 4, 4, "latin1");
+    return Buffer.concat([header, body]);
+};
+
+var uint32 = function (value) {
+    var b = Buffer.alloc(4);
+    b.writeUInt32BE(value, 0);
+    return b;
+};
+
+// Nero chapters - version 1, start in 100 ns units
+var chpl = function (chapters) {
+    var parts = [Buffer.from([1, 0, 0, 0]), uint32(0), Buffer.from([chapters.length])];
+    chapters.forEach(function (chapter) {
+        var start = Buffer.alloc(8);
+        start.writeUInt32BE(Math.floor(chapter.start * 10000 / 0x100000000), 0);
+        start.writeUInt32BE((chapter.start * 10000) % 0x100000000, 4);
+        var title = Buffer.from(chapter.title, "utf8");
+        parts.push(start, Buffer.from([title.length]), title);
+    });
+    return atom("chpl", Buffer.concat(parts));
+};
+
+var text = function (name, value) {
+    return atom(name, atom("data", uint32(1), uint32(0), Buffer.from(value, "utf8")));
+};
+
+var build = function (chunkOffset, chapters) {
+    var ftyp = atom("ftyp", Buffer.from("M4A ", "latin1"), uint32(0), Buffer.from("M4A mp42isom", "latin1"));
+    var stco = atom("stco", uint32(0), uint32(1), uint32(chunkOffset));
+    var trak = atom("trak", atom("mdia", atom("minf", atom("stbl", stco))));
+    var hdlr = atom("hdlr", uint32(0), uint32(0), Buffer.from("mdirappl", "latin1"), Buffer.alloc(9));
+    var meta = atom("meta", uint32(0), hdlr, atom("ilst", text("©nam", "Sample")));
+    var moov = atom("moov", trak, atom("udta", chpl(chapters), meta));
+    return { ftyp: ftyp, moov: moov };
+};
+
+var generate = function (chapters) {
+    var head = build(0, chapters);
+    var offset = head.ftyp.length + head.moov.length + 8;
+    head = build(offset, chapters);
+    return Buffer.concat([head.ftyp, head.moov, atom("mdat", AUDIO)]);
+};
+
+// Offset of the only chunk read from stco.
+var chunkOffset = function (file) {
+    var at = file.indexOf("stco");
+    return file.readUInt32BE(at + 12);
+};
+
+module.exports = {
+    AUDIO: AUDIO,
+    generate: generate,
+    chunkOffset: chunkOffset
+};
@@ -1,7 +1,166 @@
+"use strict";
 var fs = require("fs");
 var path = require("path");
+var tagio = require("../lib");
+var assert = require("chai").assert;
 var testDir = path.resolve(__dirname, "../build/Test");
 
 describe("Index", function() {
+    var samples;
 
+    beforeEach(function () {
+        samples = ["sample.mp3", "sample.flac", "sample.wav", "sample.ogg"].map(function (name) {
+            return path.resolve(__dirname, "../samples", name);
+        });
+        if (!fs.existsSync(testDir)) fs.mkdirSync(testDir);
+        tagio.configure();
+    });
+
+    it("readMany", function (done) {
+        var conf = { tagReadable: true };
+        tagio.readMany(samples, conf).then(function (res) {
+            assert.equal(res.length, samples.length);
+            res.forEach(function (r) {
+                assert.include(samples, r.path);
+                assert.isUndefined(r.error);
+                assert.isObject(r.tag);
+            });
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("readMany in chunks", function (done) {
+        var paths = [];
+        for (var i = 0; i < 10; i++) paths = paths.concat(samples);
+        paths.push(path.resolve(__dirname, "../samples/sample.txt"));
+        var chunks = 0;
+        var count = 0;
+        var errors = 0;
+        tagio.readMany(paths, {}, function (chunk) {
+            assert.isAtMost(chunk.length, 8);
+            chunks++;
+            count += chunk.length;
+            chunk.forEach(function (r) { if (r.error) errors++; });
+        }, { chunkSize: 8, concurrency: 3 }).then(function (res) {
+            assert.equal(res, paths.length);
+            assert.equal(count, paths.length);
+            assert.isAtLeast(chunks, Math.ceil(paths.length / 8));
+            assert.equal(errors, 1);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read with priorities over small queue", function (done) {
+        tagio.configure({ threads: 2, queueSize: 2 });
+        var reads = [];
+        for (var i = 0; i < 20; i++) {
+            var priority = (i % 2 == 0) ? tagio.Priority.BULK : tagio.Priority.INTERACTIVE;
+            reads.push(tagio.read({ path: samples[i % samples.length], priority: priority, configuration: { tagReadable: true } }));
+        }
+        reads.push(tagio.readMany(samples, { tagReadable: true }));
+        Promise.all(reads).then(function (res) {
+            assert.equal(res.length, 21);
+            res.slice(0, 20).forEach(function (r) {
+                assert.isUndefined(r.error);
+                assert.isObject(r.tag);
+            });
+            assert.equal(res[20].length, samples.length);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Reject requests over queue limit", function (done) {
+        tagio.configure({ threads: 1, queueSize: 1, queueLimit: 2 });
+        var reads = [];
+        for (var i = 0; i < 6; i++) {
+            reads.push(tagio.read({ path: samples[0] }).then(function () {
+                return "read";
+            }, function (err) {
+                return err;
+            }));
+        }
+        Promise.all(reads).then(function (res) {
+            // one request runs, two wait, the rest is rejected
+            assert.deepEqual(res, ["read", "read", "read", "Request queue full", "Request queue full", "Request queue full"]);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("scan", function (done) {
+        var root = path.resolve(testDir, "scan");
+        var count = 0;
+        [root, path.resolve(root, "a"), path.resolve(root, "a", "b")].forEach(function (dir, i) {
+            if (!fs.existsSync(dir)) fs.mkdirSync(dir);
+            samples.concat(path.resolve(__dirname, "../samples/sample.txt")).forEach(function (sample) {
+                fs.writeFileSync(path.resolve(dir, i + path.basename(sample)), fs.readFileSync(sample));
+            });
+        });
+        var iterator = tagio.scan(root, { batchSize: 3, configuration: { tagReadable: true } });
+        var next = function () {
+            return iterator.next().then(function (step) {
+                if (step.done) return;
+                assert.isAtMost(step.value.length, 3);
+                step.value.forEach(function (r) {
+                    assert.notEqual(path.extname(r.path), ".txt");
+                    assert.isUndefined(r.error);
+                    count++;
+                });
+                return next();
+            });
+        };
+        next().then(function () {
+            assert.equal(count, 3 * samples.length);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("scan lists large directory in parts", function (done) {
+        var root = path.resolve(testDir, "scanLarge");
+        if (!fs.existsSync(root)) fs.mkdirSync(root);
+        var names = ["UPPER.MP3"];
+        for (var i = 0; i < 24; i++) names.push("file" + i + ".mp3");
+        names.forEach(function (name) {
+            fs.writeFileSync(path.resolve(root, name), fs.readFileSync(samples[0]));
+        });
+        var seen = {};
+        var iterator = tagio.scan(root, { batchSize: 2, prefetch: 1, configuration: { id3v2Readable: true } });
+        var next = function () {
+            return iterator.next().then(function (step) {
+                if (step.done) return;
+                step.value.forEach(function (r) {
+                    assert.isUndefined(r.error);
+                    // read by MPEG reader whatever the case of the extension
+                    assert.isArray(r.id3v2);
+                    assert.isUndefined(seen[r.path]);
+                    seen[r.path] = true;
+                });
+                return next();
+            });
+        };
+        next().then(function () {
+            assert.equal(Object.keys(seen).length, names.length);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read with timings", function (done) {
+        var conf = { tagReadable: true, timingsReadable: true };
+        tagio.stats(true);
+        tagio.read({ path: samples[0], configuration: conf }).then(function (res) {
+            assert.isAbove(res.timings.open.ns, 0);
+            assert.isAbove(res.timings.export.ns, 0);
+            assert.isAbove(res.timings.materialize.ns, 0);
+            return tagio.readMany(samples, conf);
+        }).then(function (res) {
+            res.forEach(function (r) { assert.isObject(r.timings.open); });
+            var stats = tagio.stats();
+            assert.equal(stats.open.count, 1 + samples.length);
+            assert.equal(stats.materialize.count, 1);
+            assert.equal(stats.open.histogram.reduce(function (a, b) { return a + b; }), stats.open.count);
+            return tagio.read({ path: samples[0], configuration: { tagReadable: true } });
+        }).then(function (res) {
+            assert.isUndefined(res.timings);
+            done();
+        }).catch(function(err) { done(err); });
+    });
 });
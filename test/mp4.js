@@ -0,0 +1,120 @@
+"use strict";
+var fs = require("fs");
+var path = require("path");
+var tagio = require("../lib");
+var assert = require("chai").assert;
+var mp4Helper = require("./help/mp4");
+
+var fileCounter = 0;
+
+
+describe("MP4", function() {
+    var testDir;
+    var testFile;
+    var testJPEG;
+    var chapters = [
+        { start: 0, title: "Intro" },
+        { start: 61500, title: "Chapter 1" }
+    ];
+
+    // audio data is where the chunk offset says after the file was written
+    var assertChunkOffset = function () {
+        var file = fs.readFileSync(testFile);
+        var offset = mp4Helper.chunkOffset(file);
+        assert.isTrue(file.slice(offset, offset + mp4Helper.AUDIO.length).equals(mp4Helper.AUDIO));
+    };
+
+    beforeEach(function () {
+        testDir = path.resolve(__dirname, "../build/Test");
+        testFile = path.resolve(testDir, "test" + fileCounter++ + ".m4a");
+        testJPEG = path.resolve(__dirname, "../samples/sample.jpg");
+        if (!fs.existsSync(testDir)) fs.mkdirSync(testDir);
+        fs.writeFileSync(testFile, mp4Helper.generate(chapters));
+        tagio.configure();
+    });
+
+    afterEach(function () {
+        //fs.unlinkSync(testFile);
+        //fs.rmdirSync(testDir);
+    });
+
+    it("Read items and chapters", function(done) {
+        tagio.read({ path: testFile }).then(function (res) {
+            assert.isUndefined(res.error);
+            assert.deepEqual(res.mp4, [{ id: "©nam", text: "Sample" }]);
+            assert.deepEqual(res.chapters, chapters);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write items", function(done) {
+        const jpeg = fs.readFileSync(testJPEG);
+        const req = {
+            path: testFile,
+            configuration: { fileExtracted: tagio.FileExtracted.AS_BUFFER },
+            mp4: [
+                { id: "©nam", text: "My title" },
+                { id: "©ART", text: "My artist" },
+                { id: "trkn", number: 3, total: 12 },
+                { id: "cpil", value: true },
+                { id: "tmpo", value: 120 },
+                { id: "----:com.apple.iTunes:ASIN", text: "B000000000" },
+                { id: "covr", mimeType: "image/jpeg", picture: testJPEG }
+            ]
+        };
+        tagio.write(req).then(function (res) {
+            var cover = res.mp4.filter(function (item) { return item.id === "covr"; })[0];
+            assert.isTrue(cover.picture.equals(jpeg));
+            assertChunkOffset();
+            return tagio.read({ path: testFile, configuration: req.configuration });
+        }).then(function (res) {
+            var items = res.mp4.map(function (item) {
+                return item.id === "covr" ? { id: item.id, mimeType: item.mimeType, picture: testJPEG } : item;
+            });
+            assert.sameDeepMembers(items, req.mp4);
+            assert.deepEqual(res.chapters, chapters);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write items in place", function(done) {
+        var size;
+        tagio.write({
+            path: testFile,
+            mp4: [{ id: "©nam", text: "Part 1" }]
+        }).then(function () {
+            size = fs.statSync(testFile).size;
+            return tagio.write({
+                path: testFile,
+                mp4: [{ id: "©nam", text: "Part 1 - longer title fitting the padding" }, { id: "©alb", text: "Book" }]
+            });
+        }).then(function (res) {
+            assert.equal(fs.statSync(testFile).size, size);
+            assert.equal(res.mp4.length, 2);
+            assertChunkOffset();
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read cover as handle", function(done) {
+        const jpeg = fs.readFileSync(testJPEG);
+        const conf = { fileExtracted: tagio.FileExtracted.AS_HANDLE };
+        tagio.write({
+            path: testFile,
+            configuration: conf,
+            mp4: [{ id: "covr", mimeType: "image/jpeg", picture: jpeg }]
+        }).then(function () {
+            return tagio.read({ path: testFile, configuration: conf, fields: ["covr"] });
+        }).then(function (res) {
+            assert.equal(res.mp4.length, 1);
+            var picture = res.mp4[0].picture;
+            assert.instanceOf(picture, tagio.Attachment);
+            assert.equal(picture.length, jpeg.length);
+            return picture.load();
+        }).then(function (data) {
+            assert.isTrue(data.equals(jpeg));
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+});
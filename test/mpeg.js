@@ -47,6 +47,28 @@ describe("MPEG", function() {
         });
     });
 
+    it("Read results share shape", function(done) {
+        var request = {
+            path: testFile,
+            configuration: {
+                configurationReadable: true,
+                audioPropertiesReadable: true,
+                tagReadable: true
+            }
+        };
+
+        Promise.all([tagio.read(request), tagio.read(request)]).then(function (results) {
+            var tagKeys = ["title", "album", "artist", "track", "year", "genre", "comment"];
+            var audioKeys = ["length", "bitrate", "sampleRate", "channels"];
+            results.forEach(function (result) {
+                assert.deepEqual(Object.keys(result.tag), tagKeys);
+                assert.deepEqual(Object.keys(result.audioProperties), audioKeys);
+            });
+            assert.deepEqual(Object.keys(results[0].configuration), Object.keys(results[1].configuration));
+            done();
+        }).catch(done);
+    });
+
 
     it("Write and read ID3v1 only", function(done) {
         var req = {
@@ -277,4 +299,368 @@ describe("MPEG", function() {
             done();
         }).catch(function(err) { done(err); });
     });
+
+    it("Write ID3v2 and verify", function(done) {
+        const req = {
+            path: testFile,
+            verify: true,
+            configuration: {
+                configurationReadable: true,
+                audioPropertiesReadable: false,
+                id3v1Readable: false,
+                id3v1Writable: false,
+                id3v1Encoding: tagio.Encoding.UTF8,
+                id3v2Readable: true,
+                id3v2Writable: true,
+                apeReadable: true,
+                apeWritable: false,
+                xiphCommentReadable: true,
+                xiphCommentWritable: true
+            },
+            id3v2: id3v2Helper.generateTestFrames(testJPEG, testTEXT)
+        };
+        tagio.write(req).then(function (res) {
+            id3v2Helper.assertTestFrames(req.id3v2, res.id3v2);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write ID3v2 in place", function(done) {
+        const conf = {
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            id3v2Padding: 2048,
+            apeWritable: false
+        };
+        var size;
+        tagio.write({ path: testFile, configuration: conf, id3v2: [{ id: "TIT2", text: "Title" }] }).then(function () {
+            size = fs.statSync(testFile).size;
+            return tagio.write({ path: testFile, configuration: conf, id3v2: [{ id: "TIT2", text: "Longer Title" }] });
+        }).then(function (res) {
+            assert.equal(fs.statSync(testFile).size, size);
+            assert.equal(res.id3v2[0].text, "Longer Title");
+            return tagio.read({ path: testFile, configuration: conf });
+        }).then(function (res) {
+            assert.equal(res.id3v2.length, 1);
+            assert.equal(res.id3v2[0].text, "Longer Title");
+            assert.isAbove(res.audioProperties.length, 0);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write empty ID3v2 removes the tag", function(done) {
+        const conf = {
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        tagio.write({ path: testFile, configuration: conf, id3v2: [{ id: "TIT2", text: "Title" }] }).then(function () {
+            return tagio.write({ path: testFile, configuration: conf, id3v2: [] });
+        }).then(function (res) {
+            assert.isUndefined(res.id3v2);
+            return tagio.read({ path: testFile, configuration: conf });
+        }).then(function (res) {
+            assert.isUndefined(res.id3v2);
+            assert.notEqual(fs.readFileSync(testFile).slice(0, 3).toString(), "ID3");
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Patch ID3v2", function(done) {
+        const conf = {
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        const frames = [
+            { id: "TIT2", text: "Title" },
+            { id: "TPE1", text: "Artist" },
+            { id: "TXXX", description: "A", text: "a" },
+            { id: "TXXX", description: "B", text: "b" }
+        ];
+        var mtime;
+        tagio.write({ path: testFile, configuration: conf, id3v2: frames }).then(function () {
+            return tagio.patch({ path: testFile, configuration: conf, id3v2: [
+                { op: "set", id: "TIT2", text: "New Title" },
+                { op: "remove", id: "TXXX", description: "A" },
+                { op: "append", id: "TXXX", description: "C", text: "c" }
+            ]});
+        }).then(function (res) {
+            assert.isTrue(res.changed);
+            var texts = res.id3v2.map(function (frame) { return frame.id + ":" + (frame.description || "") + ":" + frame.text; });
+            assert.sameMembers(texts, ["TIT2::New Title", "TPE1::Artist", "TXXX:B:b", "TXXX:C:c"]);
+            mtime = fs.statSync(testFile).mtime.getTime();
+            return tagio.patch({ path: testFile, configuration: conf, id3v2: [
+                { op: "set", id: "TIT2", text: "New Title" },
+                { op: "remove", id: "COMM" }
+            ]});
+        }).then(function (res) {
+            assert.isFalse(res.changed);
+            assert.equal(fs.statSync(testFile).mtime.getTime(), mtime);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write many with shared cover", function(done) {
+        const conf = {
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        const secondFile = path.resolve(testDir, "test" + fileCounter++ + ".mp3");
+        fs.writeFileSync(secondFile, fs.readFileSync(sampleFile));
+        const req = {
+            configuration: conf,
+            shared: {
+                id3v2: [{ id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: testJPEG }]
+            },
+            files: [
+                { path: testFile, id3v2: [{ op: "set", id: "TIT2", text: "First" }] },
+                { path: secondFile, id3v2: [{ op: "set", id: "TIT2", text: "Second" }] }
+            ]
+        };
+        tagio.writeMany(req).then(function (res) {
+            assert.equal(res.length, 2);
+            ["First", "Second"].forEach(function (title, i) {
+                assert.isTrue(res[i].changed);
+                var ids = res[i].id3v2.map(function (frame) { return frame.id; });
+                assert.includeMembers(ids, ["APIC", "TIT2"]);
+                var tit2 = res[i].id3v2.filter(function (frame) { return frame.id === "TIT2"; })[0];
+                assert.equal(tit2.text, title);
+            });
+            return tagio.writeMany(req);
+        }).then(function (res) {
+            assert.isFalse(res[0].changed);
+            assert.isFalse(res[1].changed);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read shared cover as file name", function(done) {
+        const extractDir = path.resolve(testDir, "extracted" + fileCounter);
+        const conf = {
+            fileExtracted: tagio.FileExtracted.AS_FILENAME,
+            fileDirectory: extractDir,
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        const secondFile = path.resolve(testDir, "test" + fileCounter++ + ".mp3");
+        fs.writeFileSync(secondFile, fs.readFileSync(sampleFile));
+        if (!fs.existsSync(extractDir)) fs.mkdirSync(extractDir);
+        const cover = [{ id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: testJPEG }];
+        const picture = function (res) {
+            return res.id3v2.filter(function (frame) { return frame.id === "APIC"; })[0].picture;
+        };
+        var stored;
+        var stat;
+        tagio.write({ path: testFile, configuration: conf, id3v2: cover }).then(function () {
+            return tagio.write({ path: secondFile, configuration: conf, id3v2: cover });
+        }).then(function () {
+            return Promise.all([
+                tagio.read({ path: testFile, configuration: conf }),
+                tagio.read({ path: secondFile, configuration: conf })
+            ]);
+        }).then(function (res) {
+            stored = picture(res[0]);
+            assert.equal(picture(res[1]), stored);
+            // <2 characters of hash>/<hash>.jpg
+            var name = path.basename(stored);
+            assert.match(name, /^[0-9a-f]+\.jpg$/);
+            assert.equal(path.basename(path.dirname(stored)), name.substr(0, 2));
+            assert.equal(path.dirname(path.dirname(stored)), extractDir);
+            assert.isTrue(fs.readFileSync(stored).equals(fs.readFileSync(testJPEG)));
+            stat = fs.statSync(stored);
+            return tagio.read({ path: secondFile, configuration: conf });
+        }).then(function (res) {
+            assert.equal(picture(res), stored);
+            var again = fs.statSync(stored);
+            assert.equal(again.ino, stat.ino);
+            assert.equal(again.mtime.getTime(), stat.mtime.getTime());
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write many MP3 and FLAC", function(done) {
+        const conf = {
+            fileExtracted: tagio.FileExtracted.AS_BUFFER,
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false,
+            xiphCommentReadable: true,
+            xiphCommentWritable: true
+        };
+        const jpeg = fs.readFileSync(testJPEG);
+        const flacFile = path.resolve(testDir, "test" + fileCounter++ + ".FLAC");
+        fs.writeFileSync(flacFile, fs.readFileSync(path.resolve(__dirname, "../samples/sample.flac")));
+        const req = {
+            configuration: conf,
+            shared: {
+                id3v2: [
+                    { id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: testJPEG },
+                    { id: "APIC", description: "Back", mimeType: "image/jpeg", type: 4, picture: testJPEG },
+                    { id: "TIT2", text: "Shared" }
+                ],
+                pictures: [{ type: 3, mimeType: "image/jpeg", description: "Cover", width: 1, height: 1, colorDepth: 24, numColors: 0, picture: testJPEG }]
+            },
+            files: [
+                { path: testFile, id3v2: [{ op: "set", id: "TIT2", text: "Own" }] },
+                { path: flacFile, xiphComment: [{ op: "set", id: "TITLE", text: "Flac" }] }
+            ]
+        };
+        tagio.writeMany(req).then(function (res) {
+            assert.isTrue(res[0].changed);
+            var tit2 = res[0].id3v2.filter(function (frame) { return frame.id === "TIT2"; });
+            assert.deepEqual(tit2.map(function (frame) { return frame.text; }), ["Own"]);
+            var apic = res[0].id3v2.filter(function (frame) { return frame.id === "APIC"; });
+            assert.sameMembers(apic.map(function (frame) { return frame.type; }), [3, 4]);
+            apic.forEach(function (frame) { assert.isTrue(frame.picture.equals(jpeg)); });
+            assert.isUndefined(res[0].pictures);
+
+            assert.isTrue(res[1].changed);
+            assert.equal(res[1].pictures.length, 1);
+            assert.isTrue(res[1].pictures[0].picture.equals(jpeg));
+            (res[1].id3v2 || []).forEach(function (frame) { assert.notEqual(frame.id, "APIC"); });
+            return tagio.writeMany(req);
+        }).then(function (res) {
+            assert.isFalse(res[0].changed);
+            assert.isFalse(res[1].changed);
+            return tagio.writeMany({ configuration: conf, files: [{ path: testFile }, { path: testFile }] });
+        }).then(function () {
+            done(new Error("Duplicate file accepted"));
+        }, function (err) {
+            assert.include(String(err), "Duplicate file");
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write cached cover returns own buffer", function(done) {
+        const jpeg = fs.readFileSync(testJPEG);
+        const req = {
+            path: testFile,
+            configuration: {
+                fileExtracted: tagio.FileExtracted.AS_BUFFER,
+                id3v1Writable: false,
+                id3v2Readable: true,
+                id3v2Writable: true,
+                apeWritable: false
+            },
+            id3v2: [{ id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: testJPEG }]
+        };
+        tagio.write(req).then(function (res) {
+            res.id3v2[0].picture.fill(0);
+            return tagio.write(req);
+        }).then(function (res) {
+            assert.isTrue(res.id3v2[0].picture.equals(jpeg));
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read ID3v2 attachments as buffers", function(done) {
+        const conf = {
+            fileExtracted: tagio.FileExtracted.AS_BUFFER,
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        const req = {
+            path: testFile,
+            configuration: conf,
+            id3v2: id3v2Helper.generateTestFrames(testJPEG, testTEXT)
+        };
+        tagio.write(req).then(function () {
+            return tagio.read({ path: testFile, configuration: conf });
+        }).then(function (res) {
+            var apic = res.id3v2.filter(function (frame) { return frame.id === "APIC"; })[0];
+            assert.isTrue(Buffer.isBuffer(apic.picture));
+            assert.isTrue(apic.picture.equals(fs.readFileSync(testJPEG)));
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read ID3v2 attachments as handles", function(done) {
+        const jpeg = fs.readFileSync(testJPEG);
+        const req = {
+            path: testFile,
+            configuration: {
+                fileExtracted: tagio.FileExtracted.AS_HANDLE,
+                id3v1Writable: false,
+                id3v2Readable: true,
+                id3v2Writable: true,
+                apeWritable: false
+            },
+            id3v2: [{ id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: jpeg }]
+        };
+        tagio.write(req).then(function () {
+            return tagio.read({ path: testFile, configuration: req.configuration });
+        }).then(function (res) {
+            var picture = res.id3v2[0].picture;
+            assert.instanceOf(picture, tagio.Attachment);
+            assert.equal(picture.size, jpeg.length);
+            assert.equal(picture.length, jpeg.length);
+            assert.equal(picture.mimeType, "image/jpeg");
+            assert.isUndefined(picture.data);
+            return picture.load();
+        }).then(function (data) {
+            assert.isTrue(data.equals(jpeg));
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write ID3v2 attachments from buffers", function(done) {
+        const jpeg = fs.readFileSync(testJPEG);
+        const conf = {
+            fileExtracted: tagio.FileExtracted.AS_BUFFER,
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        const req = {
+            path: testFile,
+            configuration: conf,
+            id3v2: [{ id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: jpeg }]
+        };
+        tagio.write(req).then(function (res) {
+            assert.equal(res.id3v2.length, 1);
+            assert.isTrue(res.id3v2[0].picture.equals(jpeg));
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Read projected fields", function(done) {
+        const conf = {
+            fileExtracted: tagio.FileExtracted.AS_BUFFER,
+            id3v1Writable: false,
+            id3v2Readable: true,
+            id3v2Writable: true,
+            apeWritable: false
+        };
+        const req = {
+            path: testFile,
+            configuration: conf,
+            id3v2: [
+                { id: "TIT2", text: "Title" },
+                { id: "TPE1", text: "Artist" },
+                { id: "APIC", description: "Cover", mimeType: "image/jpeg", type: 3, picture: fs.readFileSync(testJPEG) }
+            ]
+        };
+        tagio.write(req).then(function () {
+            return tagio.read({ path: testFile, configuration: conf, fields: ["TIT2", "title"] });
+        }).then(function (res) {
+            assert.deepEqual(Object.keys(res.tag), ["title"]);
+            assert.equal(res.tag.title, "Title");
+            assert.equal(res.id3v2.length, 1);
+            assert.equal(res.id3v2[0].id, "TIT2");
+            assert.equal(res.id3v2[0].text, "Title");
+            done();
+        }).catch(function(err) { done(err); });
+    });
 });
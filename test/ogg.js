@@ -0,0 +1,101 @@
+"use strict";
+var fs = require("fs");
+var path = require("path");
+var tagio = require("../lib");
+var assert = require("chai").assert;
+
+var fileCounter = 0;
+
+
+describe("Ogg Vorbis", function() {
+    var testDir;
+    var sampleFile;
+    var testFile;
+
+    beforeEach(function () {
+        testDir = path.resolve(__dirname, "../build/Test");
+        sampleFile = path.resolve(__dirname, "../samples/sample.ogg");
+        testFile = path.resolve(testDir, "test" + fileCounter++ + ".ogg");
+        if (!fs.existsSync(testDir)) fs.mkdirSync(testDir);
+        fs.writeFileSync(testFile, fs.readFileSync(sampleFile));
+        tagio.configure();
+    });
+
+    afterEach(function () {
+        //fs.unlinkSync(testFile);
+        //fs.rmdirSync(testDir);
+    });
+
+    it("Write XIPH", function(done) {
+        const req = {
+            path: testFile,
+            configuration: {
+                xiphCommentReadable: true,
+                xiphCommentWritable: true
+            },
+            xiphComment: [
+                {"id": "ALBUM", "text": "My album"},
+                {"id": "ARTIST", "text": "My artist"},
+                {"id": "ARTIST", "text": "My another artist"}
+            ]
+        };
+        tagio.write(req).then(function (res) {
+            assert.sameDeepMembers(res.xiphComment, req.xiphComment);
+            return tagio.read({ path: testFile, configuration: req.configuration });
+        }).then(function (res) {
+            assert.sameDeepMembers(res.xiphComment, req.xiphComment);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Write XIPH in place", function(done) {
+        const conf = { xiphCommentPadding: 1024 };
+        var size;
+        tagio.write({
+            path: testFile,
+            configuration: conf,
+            xiphComment: [{"id": "TITLE", "text": "Episode 1"}]
+        }).then(function () {
+            size = fs.statSync(testFile).size;
+            return tagio.write({
+                path: testFile,
+                configuration: conf,
+                xiphComment: [
+                    {"id": "TITLE", "text": "Episode 1 - longer title fitting the padding"},
+                    {"id": "COMMENT", "text": "Comment"}
+                ]
+            });
+        }).then(function () {
+            assert.equal(fs.statSync(testFile).size, size);
+            return tagio.read({ path: testFile, configuration: { audioPropertiesReadable: true } });
+        }).then(function (res) {
+            assert.isUndefined(res.error);
+            assert.isAbove(res.audioProperties.length, 0);
+            assert.sameDeepMembers(res.xiphComment, [
+                {"id": "TITLE", "text": "Episode 1 - longer title fitting the padding"},
+                {"id": "COMMENT", "text": "Comment"}
+            ]);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+    it("Patch XIPH", function(done) {
+        tagio.write({
+            path: testFile,
+            xiphComment: [{"id": "TITLE", "text": "Title"}, {"id": "GENRE", "text": "Podcast"}]
+        }).then(function () {
+            return tagio.patch({
+                path: testFile,
+                xiphComment: [{ op: "set", id: "TITLE", text: "New title" }]
+            });
+        }).then(function (res) {
+            assert.isTrue(res.changed);
+            assert.sameDeepMembers(res.xiphComment, [
+                {"id": "TITLE", "text": "New title"},
+                {"id": "GENRE", "text": "Podcast"}
+            ]);
+            done();
+        }).catch(function(err) { done(err); });
+    });
+
+});